@@ -21,9 +21,13 @@
 #ifndef BATCHING_DONE_STAGE_HPP_
 #define BATCHING_DONE_STAGE_HPP_
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <future>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <iostream>
@@ -31,20 +35,30 @@
 
 #include "infer_task.hpp"
 #include "infer_resource.hpp"
+#include "infer_backend_dispatcher.hpp"
+#include "pipeline_clock.hpp"
 
 
 struct AutoSetDone {
-  explicit AutoSetDone(const std::shared_ptr<std::promise<void>>& p,
-                       std::shared_ptr<FrameInfo> data)
-      : p_(p), data_(data) {}
+  explicit AutoSetDone(const std::shared_ptr<std::promise<FrameStatus>>& p,
+                       std::shared_ptr<FrameInfo> data,
+                       const std::function<void()>& done_func = nullptr,
+                       std::shared_ptr<AutoSetDone> parent = nullptr)
+      : p_(p), data_(data), done_func_(done_func), parent_(parent) {}
   ~AutoSetDone() {
-    p_->set_value();
+    p_->set_value(status);
+    if (done_func_) done_func_();
   }
-  std::shared_ptr<std::promise<void>> p_;
+  std::shared_ptr<std::promise<FrameStatus>> p_;
   std::shared_ptr<FrameInfo> data_;
+  std::function<void()> done_func_;  // 帧处理完成后回调
+  std::shared_ptr<AutoSetDone> parent_;  // 级联时父帧的 AutoSetDone, 本帧的结果与回调都触发后才释放
+  FrameStatus status = FrameStatus::kOk;  // 析构时经结果卡返回
 };  // struct AutoSetDone
 
 using BatchingDoneInput = std::vector<std::pair<std::shared_ptr<FrameInfo>, std::shared_ptr<AutoSetDone>>>;
+// 阶段在持有资源 ticket 期间逐帧回调, 用于校验各阶段处理批次的顺序
+using StageTraceFunc = std::function<void(const std::string& stage, const FrameInfo& finfo)>;
 
 class BatchingDoneStage {
  public:
@@ -52,41 +66,84 @@ class BatchingDoneStage {
   BatchingDoneStage(uint32_t batchsize)
       : batchsize_(batchsize) {}
   virtual ~BatchingDoneStage() {}
+  // finfos.size() <= batchsize_, 提前刷出的批次可能不满
   virtual std::vector<std::shared_ptr<InferTask>> BatchingDone(const BatchingDoneInput& finfos) = 0;
+  virtual WorkerGroup Group() const { return WorkerGroup::kCpuBound; }
+  void SetClock(std::shared_ptr<PipelineClock> clock) { clock_ = clock; }
+  void SetTraceFunc(const StageTraceFunc& trace_func) { trace_func_ = trace_func; }
+  // 关闭后不再逐帧打印, 多线程压力测试等场景使用
+  void SetVerbose(bool verbose) { verbose_ = verbose; }
  protected:
+  void Trace(const std::string& stage, const FrameInfo& finfo) {
+    if (trace_func_) trace_func_(stage, finfo);
+  }
+  // 整批耗时 batch_ms 按帧数分摊到 [begin, end) 这一块, 各块之和等于整批耗时
+  static std::chrono::milliseconds ChunkCost(uint32_t batch_ms, size_t begin, size_t end, size_t num) {
+    return std::chrono::milliseconds(batch_ms * end / num - batch_ms * begin / num);
+  }
+  // 等待资源 ticket, 未就绪时通知所属线程池该 worker 阻塞
+  static IOResValue WaitResource(const std::shared_ptr<IOResource>& res, QueuingTicket* pticket) {
+    WaitInWorker(*pticket);
+    return res->WaitResourceByTicket(pticket);
+  }
+  // 分块模式下创建本批次写入 res 的进度并压入 res, 否则返回 nullptr
+  static std::shared_ptr<ChunkProgress> CreateChunkProgress(const std::shared_ptr<IOResource>& res) {
+    if (0 == res->GetChunkItems()) return nullptr;
+    auto progress = std::make_shared<ChunkProgress>();
+    res->PushChunkProgress(progress);
+    return progress;
+  }
   uint32_t batchsize_ = 0;
+  std::shared_ptr<PipelineClock> clock_ = PipelineClock::System();
+  StageTraceFunc trace_func_;
+  bool verbose_ = true;
 };  // class BatchingDoneStage
 
 
 class H2DBatchingDoneStage : public BatchingDoneStage {
  public:
+  static constexpr uint32_t kServiceMs = 100;  // 一批的模拟耗时
+
   H2DBatchingDoneStage(uint32_t batchsize,
                        std::shared_ptr<IOResource> cpu_input_res, 
-                       std::shared_ptr<IOResource> mlu_input_res)
-      : BatchingDoneStage(batchsize), cpu_input_res_(cpu_input_res), mlu_input_res_(mlu_input_res) {}
+                       std::shared_ptr<IOResourceRing> mlu_input_ring)
+      : BatchingDoneStage(batchsize), cpu_input_res_(cpu_input_res), mlu_input_ring_(mlu_input_ring) {}
+  WorkerGroup Group() const override { return WorkerGroup::kDeviceBound; }
   std::vector<std::shared_ptr<InferTask>> BatchingDone(const BatchingDoneInput& finfos) override {
     std::vector<InferTaskSptr> tasks;
     InferTaskSptr task;
 
+    std::shared_ptr<IOResource> mlu_input_res = mlu_input_ring_->NextForWrite();
+    // 分块模式下推理阶段与本阶段共用 mlu_input_res 的 ticket, 首块拷贝完成后即可开始推理
+    std::shared_ptr<ChunkProgress> mlu_input_progress = CreateChunkProgress(mlu_input_res);
     QueuingTicket cpu_input_res_ticket = cpu_input_res_->PickUpNewTicket();
-    QueuingTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
+    QueuingTicket mlu_input_res_ticket = mlu_input_res->PickUpNewTicket(nullptr != mlu_input_progress);
 
-    task = std::make_shared<InferTask>([cpu_input_res_ticket, mlu_input_res_ticket, this, finfos]() -> int {
+    task = std::make_shared<InferTask>([cpu_input_res_ticket, mlu_input_res_ticket, mlu_input_res,
+                                        mlu_input_progress, this, finfos]() -> int {
       QueuingTicket cir_ticket = cpu_input_res_ticket;
       QueuingTicket mir_ticket = mlu_input_res_ticket;
 
       // waiting for schedule
-      IOResValue cpu_value = this->cpu_input_res_->WaitResourceByTicket(&cir_ticket);
-      IOResValue mlu_value = this->mlu_input_res_->WaitResourceByTicket(&mir_ticket);
-
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      assert(finfos.size() == batchsize_);
-      for (uint32_t bidx = 0; bidx < batchsize_; bidx++) {
-        std::cout << "H2DBatchingDoneStage, bidx: " << bidx
-            << "; [" << finfos[bidx].first->batch_index << ", " << finfos[bidx].first->item_index << "] " << std::endl;
+      IOResValue cpu_value = WaitResource(this->cpu_input_res_, &cir_ticket);
+      IOResValue mlu_value = WaitResource(mlu_input_res, &mir_ticket);
+
+      assert(finfos.size() <= batchsize_);
+      size_t chunk_items = mlu_input_progress ? mlu_input_res->GetChunkItems() : finfos.size();
+      for (size_t begin = 0; begin < finfos.size(); begin += chunk_items) {
+        size_t end = std::min(begin + chunk_items, finfos.size());
+        this->clock_->SleepFor(ChunkCost(kServiceMs, begin, end, finfos.size()));
+        for (size_t bidx = begin; bidx < end; bidx++) {
+          if (this->verbose_) {
+            std::cout << "H2DBatchingDoneStage, bidx: " << bidx
+                << "; [" << finfos[bidx].first->batch_index << ", " << finfos[bidx].first->item_index << "] " << std::endl;
+          }
+          this->Trace("H2D", *finfos[bidx].first);
+        }
+        if (mlu_input_progress) mlu_input_progress->MarkReady(end);
       }
       this->cpu_input_res_->DeallingDone();
-      this->mlu_input_res_->DeallingDone();
+      mlu_input_res->DeallingDone();
       return 0;
     });
     tasks.push_back(task);
@@ -94,73 +151,192 @@ class H2DBatchingDoneStage : public BatchingDoneStage {
  } 
  private:
   std::shared_ptr<IOResource> cpu_input_res_;
-  std::shared_ptr<IOResource> mlu_input_res_;
+  std::shared_ptr<IOResourceRing> mlu_input_ring_;
 };  // class H2DBatchingDoneStage
 
 
+/**
+ * @brief device 推理
+ * device_ 使各批次的推理串行执行: 输入输出缓冲多于一份时, 相邻批次的缓冲不再互斥
+ */
 class InferBatchingDoneStage : public BatchingDoneStage {
  public:
+  static constexpr uint32_t kServiceMs = 800;
+
   InferBatchingDoneStage(uint32_t batchsize,
-                         std::shared_ptr<IOResource> mlu_input_res,
-                         std::shared_ptr<IOResource> mlu_output_res):
-      BatchingDoneStage(batchsize), mlu_input_res_(mlu_input_res), mlu_output_res_(mlu_output_res) {}
+                         std::shared_ptr<IOResourceRing> mlu_input_ring,
+                         std::shared_ptr<IOResourceRing> mlu_output_ring,
+                         std::shared_ptr<InferBackendDispatcher> dispatcher = nullptr):
+      BatchingDoneStage(batchsize), mlu_input_ring_(mlu_input_ring), mlu_output_ring_(mlu_output_ring),
+      dispatcher_(dispatcher) {}
+  WorkerGroup Group() const override { return WorkerGroup::kDeviceBound; }
   std::vector<std::shared_ptr<InferTask>> BatchingDone(const BatchingDoneInput& finfos) override {
     std::vector<InferTaskSptr> tasks;
     InferTaskSptr task;
 
-    QueuingTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
-    QueuingTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket();
-    task = std::make_shared<InferTask>([mlu_input_res_ticket, mlu_output_res_ticket, this, finfos]() -> int {
+    std::shared_ptr<IOResource> mlu_input_res = mlu_input_ring_->TakeForRead();
+    std::shared_ptr<IOResource> mlu_output_res = mlu_output_ring_->NextForWrite();
+    // 取到 H2D 的分块进度时共用其保留的 ticket
+    std::shared_ptr<ChunkProgress> mlu_input_progress = mlu_input_res->TakeChunkProgress();
+    std::shared_ptr<ChunkProgress> mlu_output_progress = CreateChunkProgress(mlu_output_res);
+    QueuingTicket mlu_input_res_ticket = mlu_input_progress ? mlu_input_res->PickUpTicket()
+                                                            : mlu_input_res->PickUpNewTicket();
+    QueuingTicket mlu_output_res_ticket = mlu_output_res->PickUpNewTicket(nullptr != mlu_output_progress);
+    QueuingTicket device_ticket = device_.PickUpNewTicket();
+    task = std::make_shared<InferTask>([mlu_input_res_ticket, mlu_output_res_ticket, device_ticket, mlu_input_res,
+                                        mlu_output_res, mlu_input_progress, mlu_output_progress, this,
+                                        finfos]() -> int {
       QueuingTicket mir_ticket = mlu_input_res_ticket;
       QueuingTicket mor_ticket = mlu_output_res_ticket;
-      IOResValue mlu_input_value = this->mlu_input_res_->WaitResourceByTicket(&mir_ticket);
-      IOResValue mlu_output_value = this->mlu_output_res_->WaitResourceByTicket(&mor_ticket);
-
-      std::this_thread::sleep_for(std::chrono::milliseconds(800));
-      assert(finfos.size() == batchsize_);
-      for (uint32_t bidx = 0; bidx < batchsize_; bidx++) {
-        std::cout << "InferBatchingDoneStage, bidx: " << bidx
-            << "; [" << finfos[bidx].first->batch_index << ", " << finfos[bidx].first->item_index << "] " << std::endl;
+      QueuingTicket dev_ticket = device_ticket;
+      IOResValue mlu_input_value = WaitResource(mlu_input_res, &mir_ticket);
+      IOResValue mlu_output_value = WaitResource(mlu_output_res, &mor_ticket);
+      WaitInWorker(dev_ticket);
+      this->device_.WaitByTicket(&dev_ticket);
+
+      auto start = this->clock_->Now();
+      assert(finfos.size() <= batchsize_);
+      size_t chunk_items = mlu_output_progress ? mlu_output_res->GetChunkItems() : finfos.size();
+      for (size_t begin = 0; begin < finfos.size(); begin += chunk_items) {
+        size_t end = std::min(begin + chunk_items, finfos.size());
+        if (mlu_input_progress) mlu_input_progress->WaitReady(end);
+        this->clock_->SleepFor(ChunkCost(kServiceMs, begin, end, finfos.size()));
+        for (size_t bidx = begin; bidx < end; bidx++) {
+          if (this->verbose_) {
+            std::cout << "InferBatchingDoneStage, bidx: " << bidx
+                << "; [" << finfos[bidx].first->batch_index << ", " << finfos[bidx].first->item_index << "] " << std::endl;
+          }
+          this->Trace("Infer", *finfos[bidx].first);
+        }
+        if (mlu_output_progress) mlu_output_progress->MarkReady(end);
       }
-      this->mlu_input_res_->DeallingDone();
-      this->mlu_output_res_->DeallingDone();
+      if (this->dispatcher_) this->dispatcher_->BatchDone(InferBackend::kDevice, this->clock_->ElapsedMs(start));
+      mlu_input_res->DeallingDone();
+      mlu_output_res->DeallingDone();
+      this->device_.DeallingDone();
       return 0;
     });
     tasks.push_back(task);
     return tasks;
   }
  private:
-  std::shared_ptr<IOResource> mlu_input_res_;
-  std::shared_ptr<IOResource> mlu_output_res_;
+  std::shared_ptr<IOResourceRing> mlu_input_ring_;
+  std::shared_ptr<IOResourceRing> mlu_output_ring_;
+  std::shared_ptr<InferBackendDispatcher> dispatcher_;
+  QueuingServer device_;
 };  // class InferBatchingDoneStage
 
+
+/**
+ * @brief CPU 后端推理: 把 cpu_input_res 拷到 CPU 专用的 cpu_infer_input_res 后即释放, 推理结果写入
+ * CPU 专用的 cpu_infer_output_ring, 由单独的后处理阶段读取, 不占用 device 路径的 cpu_output 队列
+ * cpu_input_res 与 H2D 共用 ticket 队列, 须等此前批次的 H2D 完成才能拷出
+ */
+class CpuInferBatchingDoneStage : public BatchingDoneStage {
+ public:
+  static constexpr uint32_t kServiceMs = 1600;
+  static constexpr uint32_t kCopyMs = 20;  // 从 cpu_input_res 拷出一批的模拟耗时
+
+  CpuInferBatchingDoneStage(uint32_t batchsize,
+                            std::shared_ptr<IOResource> cpu_input_res,
+                            std::shared_ptr<IOResource> cpu_infer_input_res,
+                            std::shared_ptr<IOResourceRing> cpu_infer_output_ring,
+                            std::shared_ptr<InferBackendDispatcher> dispatcher = nullptr)
+      : BatchingDoneStage(batchsize), cpu_input_res_(cpu_input_res), cpu_infer_input_res_(cpu_infer_input_res),
+        cpu_infer_output_ring_(cpu_infer_output_ring), dispatcher_(dispatcher) {}
+  std::vector<std::shared_ptr<InferTask>> BatchingDone(const BatchingDoneInput& finfos) override {
+    std::vector<InferTaskSptr> tasks;
+    InferTaskSptr task;
+
+    std::shared_ptr<IOResource> cpu_output_res = cpu_infer_output_ring_->NextForWrite();
+    // 后处理按 FIFO 取到的进度才与批次对应, 分块模式下同样登记进度 (整批一块)
+    std::shared_ptr<ChunkProgress> cpu_output_progress = CreateChunkProgress(cpu_output_res);
+    QueuingTicket staging_ticket = cpu_infer_input_res_->PickUpNewTicket();
+    QueuingTicket cpu_input_res_ticket = cpu_input_res_->PickUpNewTicket();
+    QueuingTicket cpu_output_res_ticket = cpu_output_res->PickUpNewTicket(nullptr != cpu_output_progress);
+    task = std::make_shared<InferTask>([staging_ticket, cpu_input_res_ticket, cpu_output_res_ticket, cpu_output_res,
+                                        cpu_output_progress, this, finfos]() -> int {
+      QueuingTicket sir_ticket = staging_ticket;
+      QueuingTicket cir_ticket = cpu_input_res_ticket;
+      QueuingTicket cor_ticket = cpu_output_res_ticket;
+      // 先取 CPU 专用缓冲, 之后持有 cpu_input_res 的时间只有拷贝
+      IOResValue staging_value = WaitResource(this->cpu_infer_input_res_, &sir_ticket);
+      IOResValue cpu_input_value = WaitResource(this->cpu_input_res_, &cir_ticket);
+      this->clock_->SleepFor(std::chrono::milliseconds(kCopyMs));
+      this->cpu_input_res_->DeallingDone();
+      IOResValue cpu_output_value = WaitResource(cpu_output_res, &cor_ticket);
+
+      auto start = this->clock_->Now();
+      this->clock_->SleepFor(std::chrono::milliseconds(kServiceMs));
+      assert(finfos.size() <= batchsize_);
+      for (uint32_t bidx = 0; bidx < finfos.size(); bidx++) {
+        if (this->verbose_) {
+          std::cout << "CpuInferBatchingDoneStage, bidx: " << bidx
+              << "; [" << finfos[bidx].first->batch_index << ", " << finfos[bidx].first->item_index << "] " << std::endl;
+        }
+        this->Trace("CpuInfer", *finfos[bidx].first);
+      }
+      if (cpu_output_progress) cpu_output_progress->MarkReady(finfos.size());
+      if (this->dispatcher_) this->dispatcher_->BatchDone(InferBackend::kCpu, this->clock_->ElapsedMs(start));
+      this->cpu_infer_input_res_->DeallingDone();
+      cpu_output_res->DeallingDone();
+      return 0;
+    });
+    tasks.push_back(task);
+    return tasks;
+  }
+ private:
+  std::shared_ptr<IOResource> cpu_input_res_;
+  std::shared_ptr<IOResource> cpu_infer_input_res_;
+  std::shared_ptr<IOResourceRing> cpu_infer_output_ring_;
+  std::shared_ptr<InferBackendDispatcher> dispatcher_;
+};  // class CpuInferBatchingDoneStage
+
 class D2HBatchingDoneStage : public BatchingDoneStage {
  public:
+  static constexpr uint32_t kServiceMs = 100;
+
   D2HBatchingDoneStage(uint32_t batchsize,
-                       std::shared_ptr<IOResource> mlu_output_res,
-                       std::shared_ptr<IOResource> cpu_output_res)
-      : BatchingDoneStage(batchsize), mlu_output_res_(mlu_output_res), cpu_output_res_(cpu_output_res) {}
+                       std::shared_ptr<IOResourceRing> mlu_output_ring,
+                       std::shared_ptr<IOResourceRing> cpu_output_ring)
+      : BatchingDoneStage(batchsize), mlu_output_ring_(mlu_output_ring), cpu_output_ring_(cpu_output_ring) {}
 
+  WorkerGroup Group() const override { return WorkerGroup::kDeviceBound; }
   std::vector<std::shared_ptr<InferTask>> BatchingDone(const BatchingDoneInput& finfos) override {
     std::vector<InferTaskSptr> tasks;
     InferTaskSptr task;
-    QueuingTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket();
-    QueuingTicket cpu_output_res_ticket = cpu_output_res_->PickUpNewTicket();
-    task = std::make_shared<InferTask>([mlu_output_res_ticket, cpu_output_res_ticket, this, finfos]() -> int {
+    std::shared_ptr<IOResource> mlu_output_res = mlu_output_ring_->TakeForRead();
+    std::shared_ptr<IOResource> cpu_output_res = cpu_output_ring_->NextForWrite();
+    std::shared_ptr<ChunkProgress> mlu_output_progress = mlu_output_res->TakeChunkProgress();
+    std::shared_ptr<ChunkProgress> cpu_output_progress = CreateChunkProgress(cpu_output_res);
+    QueuingTicket mlu_output_res_ticket = mlu_output_progress ? mlu_output_res->PickUpTicket()
+                                                              : mlu_output_res->PickUpNewTicket();
+    QueuingTicket cpu_output_res_ticket = cpu_output_res->PickUpNewTicket(nullptr != cpu_output_progress);
+    task = std::make_shared<InferTask>([mlu_output_res_ticket, cpu_output_res_ticket, mlu_output_res, cpu_output_res,
+                                        mlu_output_progress, cpu_output_progress, this, finfos]() -> int {
       QueuingTicket mor_ticket = mlu_output_res_ticket;
       QueuingTicket cor_ticket = cpu_output_res_ticket;
-      IOResValue mlu_output_value = this->mlu_output_res_->WaitResourceByTicket(&mor_ticket);
-      IOResValue cpu_output_value = this->cpu_output_res_->WaitResourceByTicket(&cor_ticket);
-
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      assert(finfos.size() == batchsize_);
-      for (uint32_t bidx = 0; bidx < batchsize_; bidx++) {
-        std::cout << "D2HBatchingDoneStage, bidx: " << bidx
-            << "; [" << finfos[bidx].first->batch_index << ", " << finfos[bidx].first->item_index << "] " << std::endl;
+      IOResValue mlu_output_value = WaitResource(mlu_output_res, &mor_ticket);
+      IOResValue cpu_output_value = WaitResource(cpu_output_res, &cor_ticket);
+
+      assert(finfos.size() <= batchsize_);
+      size_t chunk_items = cpu_output_progress ? cpu_output_res->GetChunkItems() : finfos.size();
+      for (size_t begin = 0; begin < finfos.size(); begin += chunk_items) {
+        size_t end = std::min(begin + chunk_items, finfos.size());
+        if (mlu_output_progress) mlu_output_progress->WaitReady(end);
+        this->clock_->SleepFor(ChunkCost(kServiceMs, begin, end, finfos.size()));
+        for (size_t bidx = begin; bidx < end; bidx++) {
+          if (this->verbose_) {
+            std::cout << "D2HBatchingDoneStage, bidx: " << bidx
+                << "; [" << finfos[bidx].first->batch_index << ", " << finfos[bidx].first->item_index << "] " << std::endl;
+          }
+          this->Trace("D2H", *finfos[bidx].first);
+        }
+        if (cpu_output_progress) cpu_output_progress->MarkReady(end);
       }
 
-      this->mlu_output_res_->DeallingDone();
-      this->cpu_output_res_->DeallingDone();
+      mlu_output_res->DeallingDone();
+      cpu_output_res->DeallingDone();
       return 0;
     });
     tasks.push_back(task);
@@ -168,35 +344,52 @@ class D2HBatchingDoneStage : public BatchingDoneStage {
   }
 
  private:
-  std::shared_ptr<IOResource> mlu_output_res_;
-  std::shared_ptr<IOResource> cpu_output_res_;
+  std::shared_ptr<IOResourceRing> mlu_output_ring_;
+  std::shared_ptr<IOResourceRing> cpu_output_ring_;
 };  // class D2HBatchingDoneStage
 
 class PostprocessingBatchingDoneStage : public BatchingDoneStage {
  public:
+  // 后处理完成并释放 cpu_output_res 后逐帧回调, 传入该帧的 AutoSetDone, 用于向下游流水线送子帧
+  using EmitFunc = std::function<void(const std::shared_ptr<FrameInfo>& finfo,
+                                      const std::shared_ptr<AutoSetDone>& auto_set_done)>;
+  static constexpr uint32_t kServiceMs = 50;  // 每帧的模拟耗时
+
   PostprocessingBatchingDoneStage(uint32_t batchsize,
-                                  std::shared_ptr<IOResource> cpu_output_res)
-      : BatchingDoneStage(batchsize), cpu_output_res_(cpu_output_res) {}
+                                  std::shared_ptr<IOResourceRing> cpu_output_ring)
+      : BatchingDoneStage(batchsize), cpu_output_ring_(cpu_output_ring) {}
+  void SetEmitFunc(const EmitFunc& emit_func) { emit_func_ = emit_func; }
+  // 跟踪回调中的阶段名, CPU 路径的后处理与 device 路径区分
+  void SetTraceStage(const std::string& trace_stage) { trace_stage_ = trace_stage; }
 
   std::vector<std::shared_ptr<InferTask>> BatchingDone(const BatchingDoneInput& finfos) override {
     std::vector<InferTaskSptr> tasks;
-    assert(finfos.size() == batchsize_);
+    assert(finfos.size() <= batchsize_);
+    std::shared_ptr<IOResource> cpu_output_res = cpu_output_ring_->TakeForRead();
+    // 取到 D2H 的分块进度时各帧共用 D2H 保留的 ticket, 所在块拷回后即可后处理
+    std::shared_ptr<ChunkProgress> cpu_output_progress = cpu_output_res->TakeChunkProgress();
     for (int bidx = 0; bidx < static_cast<int>(finfos.size()); ++bidx) {
       auto finfo = finfos[bidx];
       QueuingTicket cpu_output_res_ticket;
-      if (0 == bidx) {
-        cpu_output_res_ticket = this->cpu_output_res_->PickUpNewTicket(true);
+      if (0 == bidx && !cpu_output_progress) {
+        cpu_output_res_ticket = cpu_output_res->PickUpNewTicket(true);
       } else {
-        cpu_output_res_ticket = this->cpu_output_res_->PickUpTicket(true);
+        cpu_output_res_ticket = cpu_output_res->PickUpTicket(true);
       }
-      InferTaskSptr task =
-        std::make_shared<InferTask>([cpu_output_res_ticket, this, finfo, bidx]() -> int {
+      InferTaskSptr task = std::make_shared<InferTask>([cpu_output_res_ticket, cpu_output_res, cpu_output_progress,
+                                                        this, finfo, bidx]() -> int {
           QueuingTicket cor_ticket = cpu_output_res_ticket;
-          IOResValue cpu_output_value = this->cpu_output_res_->WaitResourceByTicket(&cor_ticket);
-          std::this_thread::sleep_for(std::chrono::milliseconds(50));
-          std::cout << "PostprocessingBatchingDoneStage, bidx: " << bidx
-                << "; [" << finfo.first->batch_index << ", " << finfo.first->item_index << "] " << std::endl;
-          this->cpu_output_res_->DeallingDone();
+          IOResValue cpu_output_value = WaitResource(cpu_output_res, &cor_ticket);
+          if (cpu_output_progress) cpu_output_progress->WaitReady(bidx + 1);
+          this->clock_->SleepFor(std::chrono::milliseconds(kServiceMs));
+          this->MakeResult(finfo.first.get());
+          if (this->verbose_) {
+            std::cout << "PostprocessingBatchingDoneStage, bidx: " << bidx
+                  << "; [" << finfo.first->batch_index << ", " << finfo.first->item_index << "] " << std::endl;
+          }
+          this->Trace(this->trace_stage_, *finfo.first);
+          cpu_output_res->DeallingDone();
+          if (this->emit_func_) this->emit_func_(finfo.first, finfo.second);
           return 0;
         });
       tasks.push_back(task);
@@ -204,7 +397,21 @@ class PostprocessingBatchingDoneStage : public BatchingDoneStage {
     return tasks;
  }
  private:
-  std::shared_ptr<IOResource> cpu_output_res_ = nullptr;
+  // 模拟后处理输出: 均匀采样帧数据的 16 个字节
+  void MakeResult(FrameInfo* finfo) {
+    const size_t kResultBytes = 16;
+    finfo->result.assign(kResultBytes, 0);
+    finfo->postprocessed = true;
+    if (!finfo->payload || 0 == finfo->payload->size()) return;
+    size_t stride = std::max<size_t>(1, finfo->payload->size() / kResultBytes);
+    for (size_t i = 0; i < kResultBytes && i * stride < finfo->payload->size(); ++i) {
+      finfo->result[i] = finfo->payload->data()[i * stride];
+    }
+  }
+
+  std::shared_ptr<IOResourceRing> cpu_output_ring_ = nullptr;
+  EmitFunc emit_func_;
+  std::string trace_stage_ = "Postprocessing";
 };  // class PostprocessingBatchingDoneStage
 
 
@@ -5,21 +5,28 @@
 
 #include "infer_task.hpp"
 #include "infer_resource.hpp"
+#include "pipeline_clock.hpp"
 
 
 class IOBatchingStage {
  public:
+  static constexpr uint32_t kServiceMs = 50;  // 每帧的模拟耗时
+
   IOBatchingStage(uint32_t batchsize, std::shared_ptr<IOResource> output_res)
       : batchsize_(batchsize), output_res_(output_res) {}
   virtual ~IOBatchingStage() {}
   std::shared_ptr<InferTask> Batching(std::shared_ptr<FrameInfo> finfo);
   void ProcessOneFrame(std::shared_ptr<FrameInfo> finfo, uint32_t bidx, IOResValue& value);
   void Reset() { batch_idx_ = 0; }
+  void SetClock(std::shared_ptr<PipelineClock> clock) { clock_ = clock; }
+  void SetVerbose(bool verbose) { verbose_ = verbose; }
 
  private:
   uint32_t batchsize_;
   uint32_t batch_idx_ = 0;
   std::shared_ptr<IOResource> output_res_;
+  std::shared_ptr<PipelineClock> clock_ = PipelineClock::System();
+  bool verbose_ = true;
 };
 
 
@@ -0,0 +1,31 @@
+#ifndef CPU_AFFINITY_HPP_
+#define CPU_AFFINITY_HPP_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief 解析 "0-3,8,10-11" 形式的 cpu 列表
+ */
+std::vector<int> ParseCpuList(const std::string& cpulist);
+
+/**
+ * @brief 查询 NUMA 节点包含的 cpu, 节点不存在 (或非 Linux) 时返回空
+ */
+std::vector<int> GetNumaNodeCpus(int node);
+
+/**
+ * @brief 将当前线程绑定到指定 cpu 集合, cpus 为空时不做处理
+ */
+bool SetCurrentThreadAffinity(const std::vector<int>& cpus);
+
+/**
+ * @brief 在绑定到 cpus 的临时线程中执行 func 并等待其结束
+ * 用于按 first-touch 策略把内存分配到 cpus 所在的 NUMA 节点
+ */
+void RunOnCpus(const std::vector<int>& cpus, const std::function<void()>& func);
+
+
+#endif  // CPU_AFFINITY_HPP_
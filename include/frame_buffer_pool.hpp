@@ -0,0 +1,78 @@
+#ifndef FRAME_BUFFER_POOL_HPP_
+#define FRAME_BUFFER_POOL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+/**
+ * @brief 帧数据缓冲
+ * 两种来源: 由 FrameBufferPool 分配并回收的自有内存; 或指向外部内存的视图 (如录制文件的映射区域),
+ * 视图通过 owner_ 维持外部内存的生命周期.
+ * 缓冲以 shared_ptr 在前处理, 后处理与 InferTransDataHelper 之间共享, 不做拷贝.
+ */
+class FrameBuffer {
+ public:
+  explicit FrameBuffer(size_t capacity)
+      : storage_(new uint8_t[capacity]), data_(storage_.get()), capacity_(capacity) {}
+  FrameBuffer(const uint8_t* data, size_t size, std::shared_ptr<const void> owner)
+      : data_(const_cast<uint8_t*>(data)), size_(size), capacity_(size), owner_(owner) {}
+
+  const uint8_t* data() const { return data_; }
+  // 视图不可写, 返回 nullptr
+  uint8_t* mutable_data() { return storage_ ? data_ : nullptr; }
+  size_t size() const { return size_; }
+  void set_size(size_t size) { size_ = size <= capacity_ ? size : capacity_; }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  std::unique_ptr<uint8_t[]> storage_;
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  std::shared_ptr<const void> owner_;
+};  // class FrameBuffer
+
+
+/**
+ * @brief 按尺寸分级的帧缓冲回收池
+ * Acquire 返回的缓冲在最后一个持有者释放时 (通常是 AutoSetDone 触发后结果被消费完) 归还到池中,
+ * 池中空闲缓冲总量不超过 max_cached_bytes, 超出部分直接释放.
+ * 尺寸分级: 每个 2 的幂区间再均分 4 级, 最小 4KB.
+ */
+class FrameBufferPool : public std::enable_shared_from_this<FrameBufferPool> {
+ public:
+  struct Stats {
+    uint64_t acquires = 0;
+    uint64_t hits = 0;                // 复用池中空闲缓冲的次数
+    size_t outstanding_bytes = 0;     // 已借出的缓冲容量
+    size_t high_water_bytes = 0;      // outstanding_bytes 峰值
+    size_t cached_bytes = 0;          // 池中空闲缓冲容量
+    double HitRate() const { return acquires ? static_cast<double>(hits) / acquires : 0; }
+  };
+
+  static std::shared_ptr<FrameBufferPool> Create(size_t max_cached_bytes) {
+    return std::shared_ptr<FrameBufferPool>(new FrameBufferPool(max_cached_bytes));
+  }
+
+  std::shared_ptr<FrameBuffer> Acquire(size_t size);
+  Stats GetStats() const;
+  static size_t SizeClass(size_t size);
+
+ private:
+  explicit FrameBufferPool(size_t max_cached_bytes) : max_cached_bytes_(max_cached_bytes) {}
+  void Recycle(FrameBuffer* buf);
+
+  static constexpr size_t kMinSizeClass = 4096;
+  const size_t max_cached_bytes_;
+  std::map<size_t, std::vector<std::unique_ptr<FrameBuffer>>> free_lists_;  // key: size class
+  Stats stats_;
+  mutable std::mutex mtx_;
+};  // class FrameBufferPool
+
+
+#endif  // FRAME_BUFFER_POOL_HPP_
@@ -0,0 +1,67 @@
+#ifndef FRAME_REPLAY_SOURCE_HPP_
+#define FRAME_REPLAY_SOURCE_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "infer_resource.hpp"
+
+
+/**
+ * @brief 录制文件回放源, 用于离线吞吐测试
+ * 录制文件由两部分组成:
+ *   <path>      所有原始帧数据顺序拼接
+ *   <path>.idx  IndexHeader (magic, version) 之后每帧一条 FrameIndexEntry 记录 (offset, size, pts_us, width, height)
+ * 记录布局变化时递增 kIndexVersion, 版本不符的索引文件拒绝打开.
+ * 数据文件以只读方式 mmap, 送出的 FrameInfo::payload 是映射区域上的视图, 不做拷贝;
+ * 视图持有映射的引用, 映射在最后一帧释放后才 munmap.
+ */
+class FrameReplaySource {
+ public:
+  struct IndexHeader {
+    uint32_t magic = kIndexMagic;
+    uint32_t version = kIndexVersion;
+  };
+  struct FrameIndexEntry {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    int64_t pts_us = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+  };
+  static constexpr uint32_t kIndexMagic = 0x58444946;  // "FIDX"
+  static constexpr uint32_t kIndexVersion = 1;
+
+  explicit FrameReplaySource(const std::string& path) : path_(path) {}
+  ~FrameReplaySource() { Close(); }
+
+  bool Open();
+  void Close();
+  size_t FrameCount() const { return index_.size(); }
+
+  /**
+   * @brief 按顺序回放全部帧
+   * @param realtime 为 true 时按录制时间戳的节奏送帧, 否则尽快送帧
+   * @return 送出的帧数
+   */
+  size_t Replay(uint32_t batchsize, bool realtime,
+                const std::function<void(std::shared_ptr<FrameInfo>)>& feed);
+
+  /**
+   * @brief 按上述格式写录制文件
+   */
+  static bool Record(const std::string& path, const std::vector<std::vector<uint8_t>>& frames,
+                     const std::vector<int64_t>& pts_us, const std::vector<FrameShape>& shapes);
+
+ private:
+  struct MappedRegion;
+  std::string path_;
+  std::vector<FrameIndexEntry> index_;
+  std::shared_ptr<MappedRegion> mapping_;
+};  // class FrameReplaySource
+
+
+#endif  // FRAME_REPLAY_SOURCE_HPP_
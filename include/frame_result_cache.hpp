@@ -0,0 +1,92 @@
+#ifndef FRAME_RESULT_CACHE_HPP_
+#define FRAME_RESULT_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "infer_resource.hpp"
+
+
+/**
+ * @brief 帧结果去重缓存
+ * 以帧内容摘要为键缓存后处理结果, 摘要命中时跳过整条流水线直接返回缓存结果.
+ * 两种摘要:
+ *   kExact       整帧数据的 64 位哈希, 仅完全相同的帧命中
+ *   kPerceptual  亮度平面 8x8 分块均值哈希 (aHash) 加全局亮度, 汉明距离不超过 max_distance
+ *                且全局亮度相近即视为相同, 用于静止画面中的近似重复帧
+ * 感知哈希在 max_distance > 0 时把 64 位哈希等分为 max_distance + 1 段, 按 (段号, 段值) 建索引:
+ * 汉明距离不超过 max_distance 的两个哈希至少有一段完全相同, 查找只比较与查询哈希有相同段的条目.
+ * 缓存按 LRU 淘汰, 占用 (结果大小 + 条目开销) 不超过 max_bytes.
+ * 与在途帧摘要相同的帧不进入缓存查找结果, 而是由调用方挂到在途帧上等待 (计入 coalesced).
+ */
+class FrameResultCache {
+ public:
+  enum class HashMode {
+    kExact = 0,
+    kPerceptual = 1,
+  };
+
+  struct FrameDigest {
+    uint64_t hash = 0;
+    uint8_t luma = 0;  // 仅 kPerceptual 使用
+    bool valid = false;
+  };
+
+  struct Stats {
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+    uint64_t coalesced = 0;  // 合并到在途相同帧的次数
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    double HitRate() const { return lookups ? static_cast<double>(hits + coalesced) / lookups : 0; }
+  };
+
+  FrameResultCache(size_t max_bytes, HashMode mode, uint32_t max_distance = 0)
+      : max_bytes_(max_bytes), mode_(mode), max_distance_(max_distance),
+        bands_((mode == HashMode::kPerceptual && max_distance > 0 && max_distance < 64) ? max_distance + 1 : 0) {}
+
+  // 只读, 可以在多个线程中同时调用
+  FrameDigest ComputeDigest(const FrameInfo& finfo) const;
+  bool Lookup(const FrameDigest& digest, std::vector<uint8_t>* result);
+  void Insert(const FrameDigest& digest, const std::vector<uint8_t>& result);
+  void AddCoalesced();
+  Stats GetStats() const;
+
+  // 索引键, 感知哈希相同但全局亮度不同的帧使用不同的键
+  static uint64_t Key(const FrameDigest& digest) { return digest.hash ^ (digest.luma * 0x9E3779B97F4A7C15ULL); }
+  static uint64_t ExactHash(const uint8_t* data, size_t size);
+  static FrameDigest PerceptualHash(const uint8_t* luma, uint32_t width, uint32_t height);
+
+ private:
+  struct Entry {
+    FrameDigest digest;
+    std::vector<uint8_t> result;
+  };
+  static constexpr size_t kEntryOverhead = 64;
+  static size_t EntryBytes(const Entry& entry) { return entry.result.size() + kEntryOverhead; }
+  bool Match(const FrameDigest& lhs, const FrameDigest& rhs) const;
+  uint64_t BandKey(uint64_t hash, uint32_t band) const;
+  // 条目加入与移出分段索引, 需持有 mtx_
+  void AddToBands(std::list<Entry>::iterator entry);
+  void RemoveFromBands(std::list<Entry>::iterator entry);
+  void Erase(std::list<Entry>::iterator entry);
+
+  const size_t max_bytes_;
+  const HashMode mode_;
+  const uint32_t max_distance_;
+  const uint32_t bands_;  // 感知哈希的分段数, 0 表示不建分段索引
+  std::list<Entry> lru_;  // 队首为最近使用
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+  std::unordered_multimap<uint64_t, std::list<Entry>::iterator> band_index_;
+  Stats stats_;
+  mutable std::mutex mtx_;
+};  // class FrameResultCache
+
+
+#endif  // FRAME_RESULT_CACHE_HPP_
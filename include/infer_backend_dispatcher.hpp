@@ -0,0 +1,64 @@
+#ifndef INFER_BACKEND_DISPATCHER_HPP_
+#define INFER_BACKEND_DISPATCHER_HPP_
+
+#include <cstdint>
+#include <mutex>
+
+
+enum class InferBackend {
+  kDevice = 0,  // H2D - Infer - D2H
+  kCpu = 1,     // 直接在 CPU 上推理, 跳过 H2D/D2H
+};
+
+/**
+ * @brief 异构执行调度: 按批次在 device 与 CPU 之间选择推理后端
+ * 预测 device 完成时间 = H2D + (在途 device 批次数 + 1) * device 单批服务时间 + D2H.
+ * CPU 批次与 device 批次共用尺寸桶的 cpu 输入缓冲, 须等此前的 H2D 取到 device 输入缓冲 (排空等待) 才能拷出:
+ * 排空等待 = max(0, 在途 device 批次数 - device 输入缓冲份数) * device 单批服务时间 + H2D,
+ * 预测 CPU 完成时间 = max(排空等待, CPU 排队) + 拷贝 + CPU 单批服务时间.
+ * CPU 在途批次达到上限, 或 device 不慢于 CPU 时走 device.
+ * 服务时间由各后端推理阶段实时上报, 以指数滑动平均估计.
+ */
+class InferBackendDispatcher {
+ public:
+  struct Counters {
+    uint64_t batches = 0;     // 累计分派的批次数
+    uint64_t done = 0;        // 累计完成的批次数
+    uint32_t inflight = 0;    // 已分派未完成的批次数
+    double service_ms = 0;    // 单批服务时间估计
+  };
+
+  // 两条路径上推理以外的固定耗时与容量
+  struct PathCosts {
+    double h2d_ms = 0;
+    double d2h_ms = 0;
+    uint32_t device_input_depth = 1;  // device 输入缓冲份数
+    double cpu_copy_ms = 0;           // CPU 批次从 cpu 输入缓冲拷出的耗时
+    uint32_t cpu_max_inflight = 1;    // CPU 路径可同时容纳的批次数
+  };
+
+  InferBackendDispatcher(double device_service_ms, double cpu_service_ms);
+
+  void SetEnable(bool enable);
+  void SetPathCosts(const PathCosts& costs);
+  InferBackend Dispatch();
+  void BatchDone(InferBackend backend, double service_ms);
+  // 批次大小变化后旧的估计不再适用, 在没有在途批次时重置
+  void ResetServiceTimes(double device_service_ms, double cpu_service_ms);
+  Counters GetCounters(InferBackend backend) const;
+
+ private:
+  Counters& CountersOf(InferBackend backend) {
+    return backend == InferBackend::kCpu ? cpu_ : device_;
+  }
+
+  static constexpr double kSmoothFactor = 0.2;
+  bool enable_ = false;
+  PathCosts costs_;
+  Counters device_;
+  Counters cpu_;
+  mutable std::mutex mtx_;
+};  // class InferBackendDispatcher
+
+
+#endif  // INFER_BACKEND_DISPATCHER_HPP_
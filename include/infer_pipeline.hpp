@@ -0,0 +1,160 @@
+#ifndef INFER_PIPELINE_HPP_
+#define INFER_PIPELINE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "infer_task.hpp"
+#include "infer_resource.hpp"
+#include "infer_backend_dispatcher.hpp"
+#include "infer_thread_pool.hpp"
+#include "batching_done_stage.hpp"
+#include "shape_bucket_batcher.hpp"
+#include "frame_result_cache.hpp"
+#include "memory_budget_manager.hpp"
+#include "pipeline_clock.hpp"
+
+
+struct InferPipelineConfig {
+  std::string name = "pipeline";         // 内存预算中缓冲名称的前缀
+  uint32_t batchsize = 4;
+  std::vector<FrameShape> frame_shapes;  // 预分配的尺寸桶, device 输入缓冲按其中最大尺寸分配
+  uint32_t bucket_max_wait_ms = 200;
+  bool enable_cpu_fallback = false;      // 批次可改走 CPU 推理, 另分配 CPU 专用的输入输出缓冲
+  double device_service_ms = 800;        // 服务时间初始估计, 运行中由推理阶段实时更新
+  double cpu_service_ms = 1600;
+  int numa_node = -1;
+  size_t output_item_bytes = 4096;       // 每帧推理输出大小, mlu_output 与 cpu_output 按其分配
+  // IO 缓冲的内存预算, 可由多条流水线共享; 为空时不设上限, 各缓冲一份
+  std::shared_ptr<MemoryBudgetManager> memory_budget;
+  uint32_t max_buffer_depth = 3;         // 启用内存预算时 mlu_input/mlu_output/cpu_output 的最大份数
+  // H2D/推理/D2H 按块流水, 每块 transfer_chunk_items 帧, 0 表示整批一块; device worker 需能同时运行这三个阶段
+  uint32_t transfer_chunk_items = 0;
+  // 结果去重缓存, 内容摘要命中的帧跳过整条流水线; result_cache_bytes 为 0 时不启用
+  size_t result_cache_bytes = 0;
+  FrameResultCache::HashMode result_cache_mode = FrameResultCache::HashMode::kExact;
+  uint32_t result_cache_max_distance = 0;
+  std::shared_ptr<PipelineClock> clock = PipelineClock::System();
+  StageTraceFunc stage_trace_func;
+  bool verbose = true;                   // 各阶段逐帧打印
+};
+
+/**
+ * @brief 前处理-H2D-推理-D2H-后处理流水线
+ * 持有各阶段及其 IO 资源, 任务按 WorkerGroup 提交到外部提供的线程池.
+ */
+class InferPipeline {
+ public:
+  using ThreadPoolGetter = std::function<std::shared_ptr<InferThreadPool>(WorkerGroup group)>;
+  // 由父帧 (已完成后处理) 生成子帧, 可以为空
+  using ChildFramesFunc = std::function<std::vector<std::shared_ptr<FrameInfo>>(const FrameInfo& parent)>;
+
+  InferPipeline(const InferPipelineConfig& config, const ThreadPoolGetter& get_thread_pool)
+      : config_(config), get_thread_pool_(get_thread_pool), batchsize_(config.batchsize) {}
+  ~InferPipeline() { Destroy(); }
+
+  // 设置内存预算时, 放不下全部尺寸桶则从最大的尺寸起放弃, 其帧被丢弃;
+  // 最小尺寸的 IO 缓冲也超出预算时返回 false, 流水线保持未初始化
+  bool Init();
+  // 排空在途帧后释放; 在途帧的子帧由下游处理, 设置了下游时须先于下游 Destroy
+  void Destroy();
+
+  /**
+   * @param parent 非空时 finfo 为该父帧的子帧, 父帧的 AutoSetDone 在 finfo 处理完成后才释放
+   */
+  ResultWaitingCard FeedData(std::shared_ptr<FrameInfo> finfo, std::shared_ptr<AutoSetDone> parent = nullptr);
+  // 刷出各尺寸桶中不满的批次
+  void Flush();
+
+  /**
+   * @brief 级联下游流水线, 需在 Init 前设置
+   * 每帧后处理完成后由 child_frames_func 生成子帧送入 downstream 组批, 子帧与父帧放入 FrameInfo::children.
+   * 后处理 worker 只把子帧放入无界队列, 由本流水线的送帧线程调用 downstream->FeedData,
+   * worker 不会阻塞在下游的组批与任务提交上.
+   * 子帧跨父帧组批, 不满的批次由下游的组批超时刷出; 两条流水线应使用相同的 ThreadPoolGetter 共享线程池.
+   * 设置下游后不启用结果缓存, 缓存命中的帧无法生成子帧.
+   */
+  void SetDownstream(std::shared_ptr<InferPipeline> downstream, const ChildFramesFunc& child_frames_func);
+
+  /**
+   * @brief 不停流水线调整 batchsize
+   * 暂停送帧, 刷出不满的批次, 等待所有在途帧走完整条流水线, 然后按新 batchsize 重建 IO 缓冲与各阶段,
+   * 再恢复送帧; 暂停期间调用 FeedData 的线程阻塞等待, 不丢帧.
+   * 暂停时长随流水线深度 (在途批次数与缓冲份数) 增长, 不会停在某个批次边界提前重建.
+   * @param drained_func 在排空状态下执行, 可用于同时调整线程池大小
+   * @return 暂停时长 (ms); max_pause_ms 内未能排空, 或新 batchsize 的缓冲超出内存预算时,
+   *         放弃重配并按原 batchsize 恢复, 返回 -1
+   */
+  double Reconfigure(uint32_t batchsize, uint32_t max_pause_ms,
+                     const std::function<void()>& drained_func = nullptr);
+
+  // 不加锁, 可在后处理 worker (如 ChildFramesFunc) 中调用; Reconfigure 排空期间返回在途帧所用的原 batchsize
+  uint32_t GetBatchsize() const { return batchsize_.load(); }
+  std::shared_ptr<InferBackendDispatcher> GetDispatcher() const { return dispatcher_; }
+  std::vector<ShapeBucketBatcher::BucketStats> GetBucketStats();
+  // 当前所有 IO 资源, 用于检查 ticket 队列状态
+  std::vector<std::shared_ptr<IOResource>> GetResources();
+  // 未启用结果缓存时返回 nullptr
+  std::shared_ptr<FrameResultCache> GetResultCache() const { return result_cache_; }
+
+ private:
+  bool Build();
+  bool BuildStages(const std::vector<FrameShape>& shapes, const std::vector<uint32_t>& depths);
+  std::vector<uint32_t> PlanBufferDepths(const std::vector<FrameShape>& shapes);
+  std::shared_ptr<IOResourceRing> CreateRing(const std::string& name, MemoryPool pool, size_t item_bytes,
+                                             uint32_t depth);
+  void Teardown();
+  ShapeBucketBatcher::StageTasks BatchingDone(ShapeBucketBatcher::Bucket* bucket, const BatchingDoneInput& finfos);
+  void FrameDone(const FrameInfo* finfo, const FrameResultCache::FrameDigest& digest);
+  void EmitChildren(const std::shared_ptr<FrameInfo>& finfo, const std::shared_ptr<AutoSetDone>& auto_set_done);
+  void ChildFeedLoop();
+
+  InferPipelineConfig config_;
+  ThreadPoolGetter get_thread_pool_;
+  std::shared_ptr<InferBackendDispatcher> dispatcher_;
+  std::shared_ptr<FrameResultCache> result_cache_;  // 只在首次 Init 时创建, 之后不再修改
+  std::atomic<bool> result_cache_enabled_{ false };  // FeedData 据此在 feed_mtx_ 外计算摘要
+  std::atomic<uint32_t> batchsize_;                   // 当前各阶段所用的 batchsize, 随 Build 更新
+  std::shared_ptr<InferPipeline> downstream_;
+  ChildFramesFunc child_frames_func_;
+  // 待送入下游的子帧及其父帧的 AutoSetDone
+  std::deque<std::pair<std::shared_ptr<FrameInfo>, std::shared_ptr<AutoSetDone>>> child_q_;
+  std::mutex child_mtx_;
+  std::condition_variable child_cond_;
+  std::thread child_feeder_;
+  bool child_feeder_running_ = false;
+
+  std::shared_ptr<IOResourceRing> cpu_output_ring_;
+  std::shared_ptr<IOResourceRing> mlu_input_ring_;
+  std::shared_ptr<IOResourceRing> mlu_output_ring_;
+  std::shared_ptr<IOResourceRing> cpu_infer_input_ring_;   // 仅启用 CPU 后端时分配
+  std::shared_ptr<IOResourceRing> cpu_infer_output_ring_;
+  std::shared_ptr<ShapeBucketBatcher> batcher_;
+  // 各尺寸桶共用的阶段, H2D 与 CPU 推理阶段由尺寸桶提供
+  std::shared_ptr<BatchingDoneStage> infer_stage_;
+  std::shared_ptr<BatchingDoneStage> d2h_stage_;
+  std::shared_ptr<BatchingDoneStage> postproc_stage_;
+  std::shared_ptr<BatchingDoneStage> cpu_postproc_stage_;  // 读 cpu_infer_output, 仅启用 CPU 后端时创建
+
+  std::mutex feed_mtx_;  // FeedData 与 Reconfigure 互斥
+  std::mutex inflight_mtx_;
+  std::condition_variable inflight_cond_;
+  uint64_t inflight_frames_ = 0;
+  bool initialized_ = false;
+  // 结果缓存未命中且已在流水线中的摘要 -> 等待其结果的相同帧
+  std::mutex pending_mtx_;
+  std::unordered_map<uint64_t, BatchingDoneInput> pending_frames_;
+};  // class InferPipeline
+
+
+#endif  // INFER_PIPELINE_HPP_
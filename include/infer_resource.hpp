@@ -1,25 +1,62 @@
 #ifndef INFER_RESOURCE_HPP_
 #define INFER_RESOURCE_HPP_
 
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
+#include "cpu_affinity.hpp"
+#include "frame_buffer_pool.hpp"
+#include "memory_budget_manager.hpp"
 #include "queuing_server.hpp"
+#include "worker_blocking.hpp"
+
+// 输入帧尺寸, 按 NV12 计算字节数
+struct FrameShape {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t Bytes() const { return static_cast<size_t>(width) * height * 3 / 2; }
+    bool operator<(const FrameShape& other) const {
+        return width != other.width ? width < other.width : height < other.height;
+    }
+    bool operator==(const FrameShape& other) const {
+        return width == other.width && height == other.height;
+    }
+};
 
 class FrameInfo {
 public:
     uint32_t batch_index = 0;
     uint32_t item_index = 0;
+    FrameShape shape;
+    int64_t pts_us = 0;
+    std::shared_ptr<FrameBuffer> payload;  // 帧数据, 各阶段共享, 不做拷贝
+    std::vector<uint8_t> result;           // 后处理结果, AutoSetDone 触发后可读
+    bool postprocessed = false;            // 经过后处理, result 由 MakeResult 写入
+    // 级联时下游流水线的子帧, 父帧的 AutoSetDone 在全部子帧完成后才触发, 触发后子帧结果可读
+    std::vector<std::shared_ptr<FrameInfo>> children;
+};
+
+// 结果卡返回的帧状态
+enum class FrameStatus {
+    kOk = 0,
+    kDropped = 1,  // 未经过流水线, result 为空: 尺寸无法建桶, 或流水线未初始化
 };
 
 class ResultWaitingCard {
 public:
-    explicit ResultWaitingCard(std::shared_ptr<std::promise<void>> ret_promise) : promise_(ret_promise) {}
-    void WaitForCall() {  // wait for set_value
-        promise_->get_future().share().get();
+    explicit ResultWaitingCard(std::shared_ptr<std::promise<FrameStatus>> ret_promise) : promise_(ret_promise) {}
+    FrameStatus WaitForCall() {  // wait for set_value
+        return promise_->get_future().share().get();
     }
 private:
-    std::shared_ptr<std::promise<void>> promise_;
+    std::shared_ptr<std::promise<FrameStatus>> promise_;
 };
 
 template <typename RetT>
@@ -46,24 +83,144 @@ struct IOResValue {
   {
     std::vector<int> datas;  // size == batch_size
     uint32_t batchsize = 0;
+    // 大小为 batchsize * item_bytes, IOResValue 的拷贝共享同一块内存
+    std::shared_ptr<uint8_t> buffer;
+    size_t item_bytes = 0;
   };
   std::vector<OneData> datas;  // size == 1
 };  // struct IOResValue
 
 
+/**
+ * @brief 一个批次在某块缓冲上的分块就绪进度
+ * 写入阶段每写完一块调用 MarkReady(已就绪帧数), 读取阶段按帧数等待, 不必等整批写完.
+ */
+class ChunkProgress {
+ public:
+  void MarkReady(uint32_t ready_items) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    if (ready_items > ready_items_) ready_items_ = ready_items;
+    lk.unlock();
+    cond_.notify_all();
+  }
+  void WaitReady(uint32_t items) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    if (ready_items_ >= items) return;
+    ScopedWorkerBlocking blocking;
+    cond_.wait(lk, [this, items]() { return ready_items_ >= items; });
+  }
+
+ private:
+  uint32_t ready_items_ = 0;
+  std::mutex mtx_;
+  std::condition_variable cond_;
+};  // class ChunkProgress
+
 class IOResource : public InferResource<IOResValue> {
  public:
-  IOResource(uint32_t batchsize) : InferResource<IOResValue>(batchsize) {}
+  IOResource(uint32_t batchsize, size_t item_bytes = 0)
+      : InferResource<IOResValue>(batchsize), item_bytes_(item_bytes) {}
+  // 指定缓冲所在的 NUMA 节点, 需在 Init 前设置; -1 表示由调用 Init 的线程决定
+  void SetNumaNode(int node) { numa_node_ = node; }
+  int GetNumaNode() const { return numa_node_; }
+  // 登记到内存预算, 需在 Init 前设置; 缓冲在分配时按 name 向 budget 预留, 最后一份拷贝释放时归还
+  void SetMemoryBudget(std::shared_ptr<MemoryBudgetManager> budget, MemoryPool pool, const std::string& name) {
+    budget_ = budget;
+    pool_ = pool;
+    budget_name_ = name;
+  }
   void Init() override {
-    value_ = Allocate(batchsize_);
+    // first-touch: 在绑定到目标节点的线程中分配并初始化缓冲
+    RunOnCpus(GetNumaNodeCpus(numa_node_), [this]() { value_ = Allocate(batchsize_); });
   }
+  // 超出内存预算时返回的 datas 为空
   IOResValue Allocate(uint32_t batchsize) {
     IOResValue res;
+    size_t bytes = batchsize * item_bytes_;
+    if (bytes > 0 && budget_ && !budget_->Reserve(budget_name_, pool_, bytes)) return res;
     res.datas.resize(1);
     res.datas[0].datas = std::vector<int>(batchsize, 0);
     res.datas[0].batchsize = batchsize;
+    if (bytes > 0) {
+      std::shared_ptr<MemoryBudgetManager> budget = budget_;
+      MemoryPool pool = pool_;
+      std::string name = budget_name_;
+      res.datas[0].buffer.reset(new uint8_t[bytes](), [budget, pool, name, bytes](uint8_t* buffer) {
+        delete[] buffer;
+        if (budget) budget->Release(name, pool, bytes);
+      });
+      res.datas[0].item_bytes = item_bytes_;
+    }
     return res;
   }
+  // Init 是否分配成功
+  bool Allocated() const { return !value_.datas.empty(); }
+  size_t GetItemBytes() const { return item_bytes_; }
+
+  /**
+   * @brief 分块传输, 非 0 时写入该缓冲的阶段每 chunk_items 帧标记一次就绪
+   * 写入阶段以保留方式取票并把本批次的 ChunkProgress 压入队列, 紧随其后组批的读取阶段取出该进度并共用同一 ticket,
+   * 两者同时开始, 读取阶段逐块等待; 读取阶段取不到进度时按整批 ticket 的方式取票.
+   */
+  void SetChunkItems(uint32_t chunk_items) { chunk_items_ = chunk_items; }
+  uint32_t GetChunkItems() const { return chunk_items_; }
+  void PushChunkProgress(std::shared_ptr<ChunkProgress> progress) {
+    std::lock_guard<std::mutex> lk(chunk_mtx_);
+    chunk_progress_q_.push_back(progress);
+  }
+  std::shared_ptr<ChunkProgress> TakeChunkProgress() {
+    std::lock_guard<std::mutex> lk(chunk_mtx_);
+    if (chunk_progress_q_.empty()) return nullptr;
+    std::shared_ptr<ChunkProgress> progress = chunk_progress_q_.front();
+    chunk_progress_q_.pop_front();
+    return progress;
+  }
+
+ private:
+  const size_t item_bytes_ = 0;
+  int numa_node_ = -1;
+  std::shared_ptr<MemoryBudgetManager> budget_;
+  MemoryPool pool_ = MemoryPool::kHost;
+  std::string budget_name_;
+  uint32_t chunk_items_ = 0;
+  std::deque<std::shared_ptr<ChunkProgress>> chunk_progress_q_;
+  std::mutex chunk_mtx_;
 };  // class IOResource
 
+/**
+ * @brief 同一用途的多份 IO 缓冲, 批次轮流使用
+ * 写入阶段按组批顺序调用 NextForWrite 轮流取缓冲, 所取序号按 FIFO 交给读取阶段的 TakeForRead;
+ * 有多个写入阶段 (D2H 与 CPU 推理都写 cpu_output) 时读取阶段仍取到与批次对应的缓冲.
+ * 只有一份时与直接使用该 IOResource 相同. 调用方需保证写入与读取阶段按组批顺序取缓冲.
+ */
+class IOResourceRing {
+ public:
+  explicit IOResourceRing(const std::vector<std::shared_ptr<IOResource>>& slots) : slots_(slots) {}
+
+  std::shared_ptr<IOResource> NextForWrite() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    size_t slot = next_slot_;
+    next_slot_ = (next_slot_ + 1) % slots_.size();
+    read_q_.push_back(slot);
+    return slots_[slot];
+  }
+  std::shared_ptr<IOResource> TakeForRead() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    // 读取阶段与写入阶段在同一把组批锁内按批次顺序取缓冲, 读取时对应的写入一定已登记
+    assert(!read_q_.empty());
+    size_t slot = read_q_.front();
+    read_q_.pop_front();
+    return slots_[slot];
+  }
+  const std::vector<std::shared_ptr<IOResource>>& Slots() const { return slots_; }
+  size_t Depth() const { return slots_.size(); }
+  size_t GetItemBytes() const { return slots_[0]->GetItemBytes(); }
+
+ private:
+  const std::vector<std::shared_ptr<IOResource>> slots_;
+  size_t next_slot_ = 0;
+  std::deque<size_t> read_q_;
+  std::mutex mtx_;
+};  // class IOResourceRing
+
 #endif  // INFER_RESOURCE_HPP_
\ No newline at end of file
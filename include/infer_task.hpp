@@ -21,6 +21,7 @@
 #ifndef INFER_TASK_HPP_
 #define INFER_TASK_HPP_
 
+#include <chrono>
 #include <functional>
 #include <future>
 #include <memory>
@@ -29,6 +30,14 @@
 
 #include <stdexcept>
 
+#include "worker_blocking.hpp"
+
+
+// 任务所属的 worker 组, 启用独立 worker 组时按此提交到不同线程池
+enum class WorkerGroup {
+  kCpuBound = 0,     // 前处理, 后处理, CPU 推理
+  kDeviceBound = 1,  // H2D, 推理, D2H
+};
 
 class InferTask;
 using InferTaskSptr = std::shared_ptr<InferTask>;
@@ -72,9 +81,7 @@ class InferTask {
   void WaitForTaskComplete() { statem_.wait(); }
 
   void WaitForFrontTasksComplete() {
-    for (const auto& task_statem : pre_task_statem_) {
-      task_statem.wait();
-    }
+    for (const auto& task_statem : pre_task_statem_) WaitInWorker(task_statem);
   }
 
  private:
@@ -21,6 +21,8 @@
 #ifndef INFER_THREAD_POOL_HPP_
 #define INFER_THREAD_POOL_HPP_
 
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <mutex>
 #include <queue>
@@ -29,30 +31,74 @@
 #include <vector>
 
 #include "infer_task.hpp"
+#include "worker_blocking.hpp"
 
 
-class InferThreadPool {
+class InferThreadPool : public WorkerBlockingObserver {
  public:
+  // 队列指标, 用于判断哪个 worker 组需要加线程
+  struct Stats {
+    uint64_t submitted = 0;        // 累计提交的任务数
+    uint64_t blocked_submits = 0;  // 因队列满而阻塞的提交次数
+    double blocked_ms = 0;         // 提交方累计阻塞时间
+    size_t queue_size = 0;         // 当前队列长度
+    size_t queue_hwm = 0;          // 队列长度峰值
+    size_t queue_capacity = 0;
+    size_t thread_num = 0;
+    size_t blocked_num = 0;        // 正在等待 ticket 或前置任务的 worker 数
+    size_t peak_thread_num = 0;
+    uint64_t spawned = 0;          // 弹性扩容新建的 worker 数
+    uint64_t retired = 0;          // 空闲超时退出的 worker 数
+  };
+
   InferThreadPool() {}
+  explicit InferThreadPool(const std::string& name) : name_(name) {}
   ~InferThreadPool() {}
 
-  void Init(size_t thread_num);
+  void Init(size_t thread_num, const std::vector<int>& cpus = {});
   void Destroy();
+  void Resize(size_t thread_num);
+  /**
+   * @brief 启用弹性扩缩容, Init/Resize 设置的线程数作为下限
+   * 所有 worker 均阻塞且队列中有任务时新建 worker, 不超过 max_thread_num;
+   * worker 空闲超过 idle_timeout_ms 后退出, 直到回到下限.
+   */
+  void SetElastic(size_t max_thread_num, uint32_t idle_timeout_ms);
 
   void SubmitTask(const InferTaskSptr& task);
   void SubmitTask(const std::vector<InferTaskSptr>& tasks);
   void SetErrorHandleFunc(const std::function<void(const std::string& err_msg)>& err_func);
+  const std::string& GetName() const { return name_; }
+  Stats GetStats();
+
+  void OnWorkerBlocked() override;
+  void OnWorkerUnblocked() override;
 
  private:
   InferTaskSptr PopTask();
 
   void TaskLoop();
+  void JoinRetiredThreads();
+  void SpawnWorker();
+  void TrySpawnWorker();
+  size_t AliveThreadNum() const { return threads_.size() - retired_ids_.size(); }
+  std::string name_ = "default";
+  Stats stats_;
   std::vector<std::thread> threads_;
+  std::vector<int> cpus_;  // worker 绑定的 cpu 集合, 为空则不绑定
   std::queue<InferTaskSptr> task_q_;
   size_t max_tnum_ = 20;
   std::mutex mtx_;
   std::condition_variable q_push_cond_;
   std::condition_variable q_pop_cond_;
+  std::condition_variable retired_cond_;
+  size_t retire_num_ = 0;  // 待退出的 worker 数
+  std::vector<std::thread::id> retired_ids_;
+  bool elastic_ = false;
+  size_t min_thread_num_ = 0;
+  size_t max_thread_num_ = 0;
+  uint32_t idle_timeout_ms_ = 0;
+  size_t blocked_num_ = 0;
   volatile bool running_ = false;
   std::function<void(const std::string& err_msg)> error_func_ = nullptr;
 };  // class InferThreadPool
@@ -32,6 +32,7 @@
 
 
 class FrameInfo;
+class ResultSink;
 
 class InferTransDataHelper {
  public:
@@ -39,12 +40,19 @@ class InferTransDataHelper {
   ~InferTransDataHelper();
 
   void SubmitData(const std::pair<std::shared_ptr<FrameInfo>, ResultWaitingCard>& data);
+  // 等待累计处理完 count 帧
+  void WaitForProcessed(uint64_t count);
+  // 设置后每帧结果就绪时追加到 sink, 传 nullptr 取消
+  void SetResultSink(std::shared_ptr<ResultSink> sink);
 
  private:
   void Loop();
   std::mutex mtx_;
   std::condition_variable cond_not_full_;
   std::condition_variable cond_not_empty_;
+  std::condition_variable cond_processed_;
+  uint64_t processed_ = 0;
+  std::shared_ptr<ResultSink> sink_;
   std::queue<std::pair<std::shared_ptr<FrameInfo>, ResultWaitingCard>> queue_;
   std::thread th_;
   std::atomic<bool> running_;
@@ -0,0 +1,113 @@
+#ifndef MEMORY_BUDGET_MANAGER_HPP_
+#define MEMORY_BUDGET_MANAGER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+enum class MemoryPool {
+  kHost = 0,    // cpu_input, cpu_output
+  kDevice = 1,  // mlu_input, mlu_output
+};
+
+/**
+ * @brief IO 缓冲的内存预算
+ * 可由同一进程内的多条流水线共享. IOResource 设置预算后, 每份缓冲在分配时向其预留, 释放时归还;
+ * 预留后超出所在内存池或全局上限的分配被拒绝. 预留量按各池的分配粒度向上取整,
+ * 取整多出的部分计为碎片.
+ * PlanDepths 在剩余预算内为各缓冲选择份数: 先保证每种缓冲一份, 再优先加深与瓶颈阶段相邻的缓冲;
+ * 规划的份数在同一把锁内记为待分配, 之后同名缓冲的 Reserve 优先使用待分配的额度,
+ * 其他流水线的规划与预留无法占用, 分配完成后由 ReleasePlanned 归还未用完的部分.
+ */
+class MemoryBudgetManager {
+ public:
+  static constexpr int kNumPools = 2;
+
+  struct Usage {
+    size_t requested_bytes = 0;
+    size_t reserved_bytes = 0;  // 按分配粒度取整后
+    uint32_t buffers = 0;
+  };
+  struct PoolStats {
+    size_t cap_bytes = 0;       // 0 表示不限
+    size_t alignment = 0;
+    Usage usage;
+    size_t peak_bytes = 0;      // reserved_bytes 峰值
+    uint64_t rejections = 0;    // 因超出预算被拒绝的分配次数
+    // 取整浪费占预留量的比例
+    double Fragmentation() const {
+      return usage.reserved_bytes ? 1.0 - static_cast<double>(usage.requested_bytes) / usage.reserved_bytes : 0;
+    }
+  };
+  struct Stats {
+    size_t global_cap_bytes = 0;
+    size_t reserved_bytes = 0;
+    size_t peak_bytes = 0;
+    PoolStats pools[kNumPools];
+    std::map<std::string, Usage> resources;  // 按缓冲名称汇总
+  };
+
+  /**
+   * @brief 一种缓冲的份数规划请求
+   * writer_ms/reader_ms 为写入与读取该缓冲的阶段处理一批的耗时, 用于判断是否与瓶颈阶段相邻
+   */
+  struct DepthRequest {
+    std::string name;
+    MemoryPool pool = MemoryPool::kHost;
+    size_t buffer_bytes = 0;
+    double writer_ms = 0;
+    double reader_ms = 0;
+    uint32_t max_depth = 1;  // 1 表示固定一份
+  };
+
+  // global_cap_bytes 为 0 表示不限
+  explicit MemoryBudgetManager(size_t global_cap_bytes = 0);
+
+  void SetPoolCap(MemoryPool pool, size_t cap_bytes);
+  void SetPoolAlignment(MemoryPool pool, size_t alignment);
+
+  // 预留一份缓冲, 同名缓冲有待分配额度时直接使用, 否则超出预算时返回 false
+  bool Reserve(const std::string& name, MemoryPool pool, size_t bytes);
+  void Release(const std::string& name, MemoryPool pool, size_t bytes);
+
+  /**
+   * @brief 在当前剩余预算内规划各缓冲的份数, 并把规划的份数记为待分配
+   * 与瓶颈阶段 (各请求中 writer_ms/reader_ms 最大者) 相邻的缓冲最多加深到 max_depth, 其余最多两份;
+   * 同一轮中按相邻阶段耗时从大到小, 占用从小到大的顺序逐份加深, 放不下的跳过.
+   * @return 与 requests 一一对应的份数; 每种一份也超出预算时返回空, 不记待分配
+   */
+  std::vector<uint32_t> PlanDepths(const std::vector<DepthRequest>& requests);
+  // 归还名称以 name_prefix 开头的缓冲未用完的待分配额度
+  void ReleasePlanned(const std::string& name_prefix);
+
+  Stats GetStats() const;
+  static const char* PoolName(MemoryPool pool);
+
+ private:
+  size_t AlignUp(MemoryPool pool, size_t bytes) const;
+  // 在已预留与待分配之外再预留 extra 是否仍在预算内, 需持有 mtx_
+  bool Fits(const size_t extra[kNumPools]) const;
+
+  // 一种缓冲的待分配额度, reserved_bytes 为单份按分配粒度取整后的大小
+  struct Plan {
+    MemoryPool pool = MemoryPool::kHost;
+    size_t reserved_bytes = 0;
+    uint32_t buffers = 0;
+  };
+
+  const size_t global_cap_bytes_;
+  size_t global_reserved_bytes_ = 0;
+  size_t global_peak_bytes_ = 0;
+  PoolStats pools_[kNumPools];
+  std::map<std::string, Usage> resources_;
+  std::map<std::string, Plan> planned_;
+  size_t planned_bytes_[kNumPools] = { 0 };
+  mutable std::mutex mtx_;
+};  // class MemoryBudgetManager
+
+
+#endif  // MEMORY_BUDGET_MANAGER_HPP_
@@ -0,0 +1,72 @@
+#ifndef PIPELINE_CLOCK_HPP_
+#define PIPELINE_CLOCK_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+
+/**
+ * @brief 流水线时钟
+ * 各阶段的模拟耗时, 组批等待超时及热重配的暂停上限都经由该接口计时与等待, 便于替换为手动推进的时钟.
+ */
+class PipelineClock {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  virtual ~PipelineClock() {}
+  virtual TimePoint Now() = 0;
+  virtual void SleepFor(std::chrono::milliseconds duration) = 0;
+  /**
+   * @brief 在 cond 上等待到 pred 成立或时钟到达 deadline, 调用时 lk 已加锁
+   * @return pred 的结果
+   */
+  virtual bool WaitUntil(std::condition_variable& cond, std::unique_lock<std::mutex>& lk, TimePoint deadline,
+                         const std::function<bool()>& pred) = 0;
+
+  double ElapsedMs(const TimePoint& start) {
+    return std::chrono::duration<double, std::milli>(Now() - start).count();
+  }
+
+  // 进程内共享的系统时钟
+  static std::shared_ptr<PipelineClock> System();
+};  // class PipelineClock
+
+class SystemClock : public PipelineClock {
+ public:
+  TimePoint Now() override { return std::chrono::steady_clock::now(); }
+  void SleepFor(std::chrono::milliseconds duration) override;
+  bool WaitUntil(std::condition_variable& cond, std::unique_lock<std::mutex>& lk, TimePoint deadline,
+                 const std::function<bool()>& pred) override;
+};  // class SystemClock
+
+/**
+ * @brief 手动推进的时钟
+ * 时间只由 Advance 推进, SleepFor 阻塞到时钟越过其截止时刻.
+ * auto_advance 为 true 时 SleepFor 直接把时钟推进到自身的截止时刻并立即返回, 模拟耗时不占用实际时间,
+ * 用于在数秒内跑完大量批次; 此时并发的 SleepFor 不会重叠计时, 时钟只反映调度顺序而非真实并行耗时,
+ * 推进顺序由线程调度决定, 同一输入多次运行的读数不可复现.
+ */
+class ManualClock : public PipelineClock {
+ public:
+  explicit ManualClock(bool auto_advance = false) : auto_advance_(auto_advance) {}
+
+  TimePoint Now() override;
+  void SleepFor(std::chrono::milliseconds duration) override;
+  bool WaitUntil(std::condition_variable& cond, std::unique_lock<std::mutex>& lk, TimePoint deadline,
+                 const std::function<bool()>& pred) override;
+  void Advance(std::chrono::milliseconds duration);
+
+ private:
+  // WaitUntil 不持有时钟锁, 以此间隔检查 pred 与时钟
+  static constexpr int kPollIntervalMs = 1;
+  const bool auto_advance_;
+  TimePoint now_;  // 从 steady_clock 纪元开始计时
+  std::mutex mtx_;
+  std::condition_variable cond_;
+};  // class ManualClock
+
+
+#endif  // PIPELINE_CLOCK_HPP_
@@ -0,0 +1,191 @@
+#ifndef PIPELINE_SIMULATOR_HPP_
+#define PIPELINE_SIMULATOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "infer_task.hpp"
+#include "queuing_server.hpp"
+
+
+/**
+ * @brief 阶段服务时间分布
+ * 单次服务时间 = base_ms + per_item_ms * 批内帧数, 再按 dist 抖动 (均值不变)
+ */
+struct SimServiceTime {
+  enum class Dist {
+    kConstant = 0,
+    kUniform = 1,      // [mean * (1 - spread), mean * (1 + spread)]
+    kExponential = 2,  // 均值为 mean 的指数分布
+  };
+  double base_ms = 0;
+  double per_item_ms = 0;
+  Dist dist = Dist::kConstant;
+  double spread = 0;
+
+  double Sample(uint32_t items, std::mt19937_64* rng) const;
+};
+
+struct SimArrival {
+  enum class Process {
+    kConstant = 0,  // 固定帧间隔
+    kPoisson = 1,   // 帧间隔服从指数分布
+  };
+  Process process = Process::kPoisson;
+  double fps = 10;
+  uint32_t num_frames = 1000;
+};
+
+struct SimConfig {
+  uint32_t batchsize = 4;
+  // 与 InferPipelineConfig::max_buffer_depth 相同, 只在启用内存预算的流水线上生效; 1 表示各缓冲一份.
+  // 大于 1 时 mlu_input/mlu_output/cpu_output 按 InferPipeline 在预算充足时规划的份数轮流使用, cpu 输入缓冲固定一份
+  uint32_t max_buffer_depth = 1;
+  uint32_t bucket_max_wait_ms = 200;
+  // 与 main 中的线程池配置对应: 独立 worker 组时两组分别有 cpu_threads/device_threads 个 worker,
+  // 否则所有任务共用 shared_threads 个 worker
+  bool dedicated_worker_groups = false;
+  size_t shared_threads = 16;
+  size_t cpu_threads = 4;          // kCpuBound worker 数
+  size_t device_threads = 4;       // kDeviceBound worker 数
+  // 大于 0 时按弹性线程池模拟: 上述线程数为初始值, worker 全部阻塞且有任务等待时新建 worker, 不超过 max_threads
+  size_t max_threads = 0;
+  // 默认值与各 BatchingDoneStage 中的 sleep 时长一致
+  SimServiceTime preprocessing = { 0, 50 };   // 每帧一个任务
+  SimServiceTime h2d = { 100, 0 };
+  SimServiceTime infer = { 800, 0 };
+  SimServiceTime d2h = { 100, 0 };
+  SimServiceTime postprocessing = { 0, 50 };  // 每帧一个任务
+  uint64_t seed = 1;
+};
+
+struct SimResult {
+  uint32_t frames = 0;            // 完成的帧数
+  uint32_t batches = 0;
+  uint32_t timeout_flushes = 0;
+  double duration_ms = 0;         // 首帧到达至末帧完成
+  double throughput_fps = 0;
+  double latency_mean_ms = 0;     // 帧到达至后处理完成
+  double latency_p50_ms = 0;
+  double latency_p90_ms = 0;
+  double latency_p99_ms = 0;
+  double latency_max_ms = 0;
+  double infer_busy = 0;          // 推理阶段占用率, 接近 1 表示推理已是瓶颈
+  bool deadlock = false;          // worker 全部阻塞在 ticket 上且无待处理事件
+};
+
+/**
+ * @brief 流水线离线离散事件仿真
+ * 按 device 路径的阶段拓扑 (前处理 - H2D - 推理 - D2H - 后处理) 在虚拟时钟上推进, 不调用 sleep_for.
+ * 各 IO 资源使用真实的 QueuingServer, 各阶段按与 IOBatchingStage/BatchingDoneStage 相同的顺序与方式取票,
+ * 因此批次间的排队, 保留票及不满批次的行为与实际流水线一致; ticket 是否就绪通过 wait_for(0) 判断.
+ * 与实际流水线一样只有推理在 device 上串行, 各缓冲环独立轮转.
+ * worker 与实际线程池一样按 FIFO 取任务, 取到 ticket 未就绪的任务时阻塞占用该 worker.
+ * 不模拟 CPU 后端回退, H2D/推理/D2H 分块传输, 尺寸分桶 (所有帧同一尺寸), 有界任务队列对提交方的阻塞
+ * 与弹性线程池的空闲退出.
+ */
+class PipelineSimulator {
+ public:
+  explicit PipelineSimulator(const SimConfig& config, const SimArrival& arrival)
+      : config_(config), arrival_(arrival) {}
+
+  SimResult Run();
+
+  /**
+   * @brief 遍历范围, 只包含流水线能够应用的配置
+   * 线程数不单独遍历, 由 set_threads 按 batchsize 取运行时线程池的实际配置
+   */
+  struct SweepSpace {
+    std::vector<uint32_t> batchsizes;
+    std::vector<uint32_t> max_buffer_depths;  // 未启用内存预算时只能为 { 1 }
+    std::vector<uint32_t> bucket_max_wait_ms;
+    std::function<void(SimConfig* config)> set_threads;  // 为空时沿用 base 的线程配置
+  };
+  struct SweepEntry {
+    SimConfig config;
+    SimResult result;
+  };
+  /**
+   * @brief 在 base 基础上遍历 space 中的全部组合
+   * @param max_p99_ms 时延约束, 0 表示不约束
+   * @param best 输出推荐配置: 满足时延约束且吞吐最高的组合, 吞吐相当 (差距 1% 内) 时取占用资源少的;
+   *             没有满足约束的组合时不修改 best
+   * @return 全部组合的结果
+   */
+  static std::vector<SweepEntry> Sweep(const SimConfig& base, const SimArrival& arrival, const SweepSpace& space,
+                                       double max_p99_ms, SweepEntry* best);
+
+ private:
+  struct Task {
+    WorkerGroup group = WorkerGroup::kCpuBound;
+    std::vector<std::pair<QueuingServer*, QueuingTicket>> waits;  // 开始服务前需就绪的 ticket
+    const SimServiceTime* service = nullptr;
+    uint32_t items = 1;
+    std::vector<uint32_t> frames;  // 完成后视为处理完毕的帧, 仅后处理任务非空
+  };
+  struct Worker {
+    int queue = 0;               // 取任务的队列, 见 QueueIndex
+    std::shared_ptr<Task> task;  // 非空且 !serving 时表示阻塞在 ticket 上
+    bool serving = false;
+  };
+  struct Event {
+    enum class Type { kArrival = 0, kTimeout = 1, kComplete = 2 };
+    double time_ms = 0;
+    uint64_t seq = 0;  // 同一时刻的事件按产生顺序处理
+    Type type = Type::kArrival;
+    uint64_t arg = 0;
+    Worker* worker = nullptr;
+    bool operator<(const Event& other) const {  // 供 std::priority_queue 取最早事件
+      return time_ms != other.time_ms ? time_ms > other.time_ms : seq > other.seq;
+    }
+  };
+  // 与 IOResourceRing 相同, 每刷出一批轮转到下一份缓冲
+  struct Ring {
+    std::vector<std::shared_ptr<QueuingServer>> slots;
+    uint32_t next = 0;
+    QueuingServer* Next() { return slots[next++ % slots.size()].get(); }
+  };
+
+  void PlanDepths(uint32_t depths[3]) const;
+  void AddWorker(int queue);
+  int QueueIndex(WorkerGroup group) const;
+  void PushEvent(Event::Type type, double time_ms, uint64_t arg = 0, Worker* worker = nullptr);
+  void Feed(uint32_t frame_id);
+  void FlushBatch(bool timeout);
+  void Submit(const std::shared_ptr<Task>& task);
+  void Dispatch();
+  void Complete(Worker* worker);
+
+  const SimConfig config_;
+  const SimArrival arrival_;
+
+  double now_ms_ = 0;
+  std::mt19937_64 rng_;
+  QueuingServer cpu_input_;        // 尺寸桶的 cpu 输入缓冲固定一份
+  Ring mlu_input_;
+  Ring mlu_output_;
+  Ring cpu_output_;
+  QueuingServer device_;           // 推理在单个 device 上串行执行, 与使用哪份缓冲无关
+  uint32_t batch_idx_ = 0;         // 当前批次中的帧序号, 与 IOBatchingStage::batch_idx_ 相同
+  std::vector<uint32_t> pending_frames_;
+  uint64_t pending_batch_seq_ = 0;  // 用于忽略已失效的超时事件
+  std::vector<double> arrival_ms_;
+  std::vector<double> done_ms_;
+  std::vector<std::shared_ptr<Worker>> workers_;
+  std::deque<std::shared_ptr<Task>> queues_[2];  // FIFO 任务队列, 共用线程池时只用第一个
+  size_t queue_threads_[2] = { 0, 0 };
+  std::priority_queue<Event> events_;
+  uint64_t event_seq_ = 0;
+  double infer_busy_ms_ = 0;
+  SimResult result_;
+};  // class PipelineSimulator
+
+
+#endif  // PIPELINE_SIMULATOR_HPP_
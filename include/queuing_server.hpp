@@ -21,6 +21,7 @@
 #ifndef MODULES_INFERENCE_SRC_QUEUING_SERVER_HPP_
 #define MODULES_INFERENCE_SRC_QUEUING_SERVER_HPP_
 
+#include <cstdint>
 #include <future>
 #include <mutex>
 #include <queue>
@@ -40,6 +41,10 @@ class QueuingServer {
   QueuingTicket PickUpNewTicket(bool reserve = false);
   void DeallingDone();
   void WaitByTicket(QueuingTicket* pticket);
+  // 没有未处理完的 ticket: 队列为空, 或仅剩已处理完但仍保留在队尾的 ticket
+  bool Idle();
+  // 进程内 PickUpNewTicket 发现 ticket 队列状态异常 ("Internel error") 的累计次数
+  static uint64_t InternalErrorCount();
 
  private:
   void Call();
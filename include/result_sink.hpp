@@ -0,0 +1,140 @@
+#ifndef RESULT_SINK_HPP_
+#define RESULT_SINK_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "infer_resource.hpp"
+
+
+/**
+ * @brief 结果落盘
+ * 把后处理结果序列化为带长度前缀的二进制记录, 顺序拼接到若干块大缓冲中,
+ * 写满一块交给专用写线程写入文件; 可用 liburing 时以 io_uring 异步写, 否则用 pwrite.
+ * 文件经页缓存写入 (不使用 O_DIRECT), 写入的偏移与长度没有对齐要求.
+ * 缓冲块数固定, 内存占用不超过 num_buffers * buffer_bytes; 所有缓冲都在写出时 Append 阻塞等待.
+ * 文件格式 (主机字节序):
+ *   文件头  u32 magic, u32 version
+ *   记录    u32 record_bytes (不含自身), u32 batch_index, u32 item_index, i64 pts_us,
+ *           u32 result_bytes, result, u32 num_children, 每个子帧 { u32 result_bytes, result }
+ * 记录可跨缓冲块, 文件即记录流.
+ */
+class ResultSink {
+ public:
+  struct Stats {
+    uint64_t records = 0;
+    uint64_t bytes = 0;          // 已写入文件的字节, 含文件头
+    uint64_t buffers = 0;        // 已写出的缓冲块数
+    uint64_t stalls = 0;         // Append 等待空闲缓冲的次数
+    uint64_t write_errors = 0;
+    double elapsed_s = 0;        // Open 至今, 关闭后为 Open 至 Close
+    double io_s = 0;             // 写线程在写文件与 fdatasync 中的累计时间
+    double MBps() const { return elapsed_s > 0 ? bytes / elapsed_s / (1 << 20) : 0; }
+    double IoMBps() const { return io_s > 0 ? bytes / io_s / (1 << 20) : 0; }
+  };
+
+  static constexpr uint32_t kMagic = 0x544C5352;  // "RSLT"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr size_t kAlignment = 4096;
+
+  // buffer_bytes 向上取整到 kAlignment 的整数倍
+  explicit ResultSink(const std::string& path, size_t buffer_bytes = 1 << 20, uint32_t num_buffers = 4);
+  ~ResultSink();
+
+  // 打开文件或分配缓冲失败时返回 false
+  bool Open();
+  // 序列化一帧及其子帧的结果
+  void Append(const FrameInfo& finfo);
+  // 刷出当前不满的缓冲并等待已提交的缓冲全部写完
+  void Flush();
+  // 刷出剩余数据, fdatasync 后关闭文件
+  void Close();
+  Stats GetStats() const;
+  // 是否使用 io_uring 写文件; 未编译 liburing 支持或初始化失败时为 pwrite
+  bool UsingIoUring() const { return nullptr != uring_; }
+
+ private:
+  struct Buffer {
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    uint64_t offset = 0;  // 写入的文件偏移
+  };
+  struct IoUring;
+
+  void AppendBytes(std::unique_lock<std::mutex>* lk, const uint8_t* data, size_t size);
+  // 把当前缓冲交给写线程, 需持有 mtx_
+  void SubmitCurrent();
+  void WriteLoop();
+  // 写线程中同步写出 buf 中 [done, size) 部分
+  void WriteSync(Buffer* buf, size_t done);
+  void WriteDone(Buffer* buf, size_t written, double io_s);
+
+  const std::string path_;
+  const size_t buffer_bytes_;
+  const uint32_t num_buffers_;
+  int fd_ = -1;
+  std::unique_ptr<IoUring> uring_;
+  std::vector<Buffer> buffers_;
+  std::deque<Buffer*> free_q_;
+  std::deque<Buffer*> full_q_;
+  Buffer* current_ = nullptr;
+  uint64_t next_offset_ = 0;
+  std::vector<uint8_t> record_;
+  Stats stats_;
+  std::chrono::steady_clock::time_point open_time_;
+  bool opened_ = false;
+  bool stopping_ = false;
+  std::thread writer_;
+  mutable std::mutex mtx_;
+  std::condition_variable full_cond_;
+  std::condition_variable free_cond_;
+};  // class ResultSink
+
+
+/**
+ * @brief 按写入顺序流式读取 ResultSink 文件, 只占用一块读缓冲
+ */
+class ResultSinkReader {
+ public:
+  struct Record {
+    uint32_t batch_index = 0;
+    uint32_t item_index = 0;
+    int64_t pts_us = 0;
+    std::vector<uint8_t> result;
+    std::vector<std::vector<uint8_t>> children;  // 子帧结果
+  };
+
+  explicit ResultSinkReader(const std::string& path, size_t buffer_bytes = 1 << 20)
+      : path_(path), buf_(buffer_bytes) {}
+  ~ResultSinkReader() { Close(); }
+
+  bool Open();
+  void Close();
+  // 读取下一条记录; 文件结束或记录损坏时返回 false, 损坏时 Corrupted() 为 true
+  bool Next(Record* record);
+  bool Corrupted() const { return corrupted_; }
+
+  static constexpr uint32_t kMaxRecordBytes = 64 << 20;  // 超过视为记录损坏
+
+ private:
+  // 保证读缓冲中至少有 size 字节, 必要时扩大读缓冲
+  bool Fill(size_t size);
+
+  const std::string path_;
+  int fd_ = -1;
+  std::vector<uint8_t> buf_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  bool corrupted_ = false;
+};  // class ResultSinkReader
+
+
+#endif  // RESULT_SINK_HPP_
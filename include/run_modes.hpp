@@ -0,0 +1,55 @@
+#ifndef RUN_MODES_HPP_
+#define RUN_MODES_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_buffer_pool.hpp"
+#include "infer_pipeline.hpp"
+#include "infer_resource.hpp"
+#include "infer_trans_data_helper.hpp"
+#include "pipeline_simulator.hpp"
+
+
+/**
+ * @brief 压力测试: 各阶段在自动推进的手动时钟上运行, 模拟耗时不占用实际时间
+ * 批次的执行交错取决于线程调度, 每次运行不同, 输出的虚拟时长也随之变化; 校验项与调度顺序无关.
+ * 随机尺寸送帧, 随机提前刷出不满的批次, 中途热重配一次 batchsize, 校验:
+ *   各阶段按批次刷出顺序处理 (每个阶段看到的批次序号不减), 每帧按阶段顺序经过流水线
+ *   每帧恰好后处理一次, 结果来自该帧自身的数据
+ *   没有出现 "Internel error", 排空后各 IO 资源没有未处理完的 ticket
+ * 组批超时设为极大值, 批次只在攒满或主动刷出时形成, 以便送帧线程预先确定每帧所属的批次序号.
+ * @param pipeline 输出按压力测试配置创建的流水线, 供调用方打印统计与 Destroy
+ * @return 校验全部通过返回 true
+ */
+bool RunStress(InferPipelineConfig config, uint32_t num_batches,
+               const InferPipeline::ThreadPoolGetter& get_thread_pool, uint32_t max_reconfigure_pause_ms,
+               std::shared_ptr<FrameBufferPool> buffer_pool, std::shared_ptr<InferPipeline>* pipeline);
+
+/**
+ * @brief 回放录制文件, 统计包含前处理在内的端到端吞吐
+ */
+bool RunReplay(const std::string& path, bool realtime, std::shared_ptr<InferPipeline> pipeline,
+               std::shared_ptr<InferTransDataHelper> trans_helper);
+
+/**
+ * @brief 写合成录制文件, 供 --replay 回放; 按 shapes 轮流取尺寸, 每帧数据按帧序号填充
+ */
+bool RunRecord(const std::string& path, const std::vector<FrameShape>& shapes, uint32_t num_frames,
+               int64_t frame_interval_us);
+
+/**
+ * @brief 离线仿真: 先按当前配置预测, 再遍历配置组合给出推荐, 不启动线程池与流水线
+ * 只遍历流水线能够应用的配置: batchsize 与组批超时, 线程数随 batchsize 由 set_threads 按运行时的规则取值;
+ * 缓冲份数只在 config.max_buffer_depth 大于 1 (启用内存预算) 时才能加深, 且假设预算足够按规划分配.
+ * 仿真只覆盖整批传输的 device 路径, 输出中注明; 当前配置启用了仿真不覆盖的特性时只输出遍历结果, 不给出推荐.
+ * @param unmodelled_options 已启用但仿真不覆盖的命令行选项
+ */
+void RunSimulation(double fps, const SimConfig& config, const std::function<void(SimConfig* config)>& set_threads,
+                   const std::vector<std::string>& unmodelled_options);
+
+
+#endif  // RUN_MODES_HPP_
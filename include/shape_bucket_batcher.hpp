@@ -0,0 +1,149 @@
+#ifndef SHAPE_BUCKET_BATCHER_HPP_
+#define SHAPE_BUCKET_BATCHER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "infer_task.hpp"
+#include "infer_resource.hpp"
+#include "infer_backend_dispatcher.hpp"
+#include "batching_stage.hpp"
+#include "batching_done_stage.hpp"
+#include "memory_budget_manager.hpp"
+#include "pipeline_clock.hpp"
+
+
+/**
+ * @brief 按输入尺寸分桶组批
+ * 每种尺寸一个桶, 桶内有独立预分配的 cpu_input_res 及对应的前处理/H2D/CPU 推理阶段;
+ * 推理, D2H, 后处理阶段及线程池由所有桶共用, device 输入缓冲按最大尺寸分配.
+ * 桶攒满 batchsize 帧, 或最早一帧等待超过 max_wait_ms 时刷出批次.
+ * 各阶段在 mtx_ 内按批次顺序取票并创建任务, 任务按同一顺序排队, 解锁后再提交到线程池:
+ * 提交因线程池队列满而阻塞时不持有 mtx_, 不影响其他桶组批.
+ */
+class ShapeBucketBatcher {
+ public:
+  struct BucketStats {
+    FrameShape shape;
+    uint64_t frames = 0;
+    uint64_t batches = 0;
+    uint64_t timeout_flushes = 0;  // 因等待超时刷出的不满批次
+    uint64_t padded_slots = 0;     // 不满批次空出的帧位
+    uint64_t padding_bytes = 0;    // device 输入缓冲中未被有效数据占用的字节 (空帧位 + 尺寸对齐)
+    size_t buffer_num = 0;
+    size_t buffer_bytes = 0;       // 桶独占的预分配缓冲
+  };
+
+  struct Bucket {
+    FrameShape shape;
+    std::shared_ptr<IOResource> cpu_input_res;
+    std::shared_ptr<IOBatchingStage> batching_stage;
+    std::shared_ptr<BatchingDoneStage> h2d_stage;
+    std::shared_ptr<BatchingDoneStage> cpu_infer_stage;  // 未启用 CPU 后端时为空
+    BatchingDoneInput finfos;
+    PipelineClock::TimePoint first_arrival;
+    BucketStats stats;
+  };
+
+  // 按提交顺序排列的各阶段任务
+  using StageTasks = std::vector<std::pair<WorkerGroup, std::vector<InferTaskSptr>>>;
+  using SubmitFunc = std::function<void(WorkerGroup group, const std::vector<InferTaskSptr>& tasks)>;
+  using FlushFunc = std::function<StageTasks(Bucket* bucket, const BatchingDoneInput& finfos)>;
+
+  /**
+   * @param cpu_infer_input_res, cpu_infer_output_ring CPU 后端专用的缓冲, 为空时不创建 CPU 推理阶段
+   */
+  ShapeBucketBatcher(uint32_t batchsize, uint32_t max_wait_ms,
+                     std::shared_ptr<IOResourceRing> mlu_input_ring,
+                     std::shared_ptr<IOResource> cpu_infer_input_res,
+                     std::shared_ptr<IOResourceRing> cpu_infer_output_ring,
+                     std::shared_ptr<InferBackendDispatcher> dispatcher)
+      : batchsize_(batchsize), max_wait_ms_(max_wait_ms), mlu_input_ring_(mlu_input_ring),
+        cpu_infer_input_res_(cpu_infer_input_res), cpu_infer_output_ring_(cpu_infer_output_ring),
+        dispatcher_(dispatcher) {}
+  ~ShapeBucketBatcher() { Stop(); }
+
+  /**
+   * @param submit_func 把任务提交到 group 对应的线程池, 不持有 mtx_ 时调用, 可以阻塞
+   * @param flush_func 批次刷出时在 mtx_ 内调用, 为批次后续阶段取票并返回其任务, 不得提交或阻塞
+   */
+  void SetFuncs(const SubmitFunc& submit_func, const FlushFunc& flush_func);
+  // 桶缓冲所在的 NUMA 节点, 需在 AddBucket 前设置
+  void SetNumaNode(int node) { numa_node_ = node; }
+  // 桶内阶段的时钟与跟踪回调, 需在 AddBucket 前设置
+  void SetClock(std::shared_ptr<PipelineClock> clock) { clock_ = clock; }
+  void SetTraceFunc(const StageTraceFunc& trace_func) { trace_func_ = trace_func; }
+  void SetVerbose(bool verbose) { verbose_ = verbose; }
+  // 桶缓冲登记到的内存预算, 名称为 name_prefix + "cpu_input WxH"; 需在 AddBucket 前设置, 超出预算的尺寸不建桶
+  void SetMemoryBudget(std::shared_ptr<MemoryBudgetManager> budget, const std::string& name_prefix) {
+    budget_ = budget;
+    budget_name_prefix_ = name_prefix;
+  }
+  static std::string BucketBufferName(const FrameShape& shape) {
+    return "cpu_input " + std::to_string(shape.width) + "x" + std::to_string(shape.height);
+  }
+  // 预分配尺寸桶, 需在 Start 前调用; 未预分配的尺寸在首帧到达时分配, 设置内存预算时则直接丢弃
+  void AddBucket(const FrameShape& shape);
+  // 不为该尺寸建桶, 其帧直接丢弃, 用于内存预算放不下的尺寸; 需在 Start 前调用
+  void RefuseShape(const FrameShape& shape);
+  void Start();
+  void Stop();
+
+  /**
+   * @brief 送入一帧, 返回前本帧及其刷出的批次的任务均已提交
+   * @return 尺寸无法建桶 (超出 device 输入缓冲或内存预算) 时返回 false 并把 auto_set_done 置为 kDropped;
+   *         同一尺寸只尝试建桶一次
+   */
+  bool Feed(std::shared_ptr<FrameInfo> finfo, std::shared_ptr<AutoSetDone> auto_set_done);
+  void FlushAll();
+  std::vector<BucketStats> GetStats();
+  // 各桶独占的 cpu 输入资源
+  std::vector<std::shared_ptr<IOResource>> GetResources();
+
+ private:
+  Bucket* GetBucket(const FrameShape& shape);
+  Bucket* CreateBucket(const FrameShape& shape);
+  void Flush(Bucket* bucket, bool timeout);
+  void SubmitPending(std::unique_lock<std::mutex>& lk);
+  void TimeoutLoop();
+
+  const uint32_t batchsize_;
+  const uint32_t max_wait_ms_;
+  std::shared_ptr<IOResourceRing> mlu_input_ring_;
+  std::shared_ptr<IOResource> cpu_infer_input_res_;
+  std::shared_ptr<IOResourceRing> cpu_infer_output_ring_;
+  std::shared_ptr<InferBackendDispatcher> dispatcher_;
+  std::shared_ptr<MemoryBudgetManager> budget_;
+  std::string budget_name_prefix_;
+  SubmitFunc submit_func_;
+  FlushFunc flush_func_;
+  std::map<FrameShape, std::unique_ptr<Bucket>> buckets_;
+  std::set<FrameShape> rejected_shapes_;  // 建桶失败的尺寸, 后续帧直接丢弃
+  // 已取票待提交的任务, 按取票顺序由一个线程在 mtx_ 外提交
+  std::deque<StageTasks> submit_q_;
+  uint64_t queued_num_ = 0;
+  uint64_t submitted_num_ = 0;
+  bool submitting_ = false;
+  std::condition_variable submit_cond_;
+  int numa_node_ = -1;
+  std::shared_ptr<PipelineClock> clock_ = PipelineClock::System();
+  StageTraceFunc trace_func_;
+  bool verbose_ = true;
+  std::mutex mtx_;
+  std::condition_variable stop_cond_;
+  std::thread timeout_th_;
+  bool running_ = false;
+};  // class ShapeBucketBatcher
+
+
+#endif  // SHAPE_BUCKET_BATCHER_HPP_
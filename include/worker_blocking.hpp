@@ -0,0 +1,52 @@
+#ifndef WORKER_BLOCKING_HPP_
+#define WORKER_BLOCKING_HPP_
+
+#include <chrono>
+#include <future>
+
+
+/**
+ * @brief 线程池 worker 阻塞观察者
+ * worker 线程启动时登记所属线程池, 在等待 ticket 或前置任务时通过 ScopedWorkerBlocking 通知线程池,
+ * 弹性线程池据此统计阻塞的 worker 数.
+ */
+class WorkerBlockingObserver {
+ public:
+  virtual ~WorkerBlockingObserver() {}
+  virtual void OnWorkerBlocked() = 0;
+  virtual void OnWorkerUnblocked() = 0;
+
+  // 当前线程所属的线程池, 非 worker 线程为 nullptr
+  static WorkerBlockingObserver*& Current() {
+    static thread_local WorkerBlockingObserver* observer = nullptr;
+    return observer;
+  }
+};  // class WorkerBlockingObserver
+
+class ScopedWorkerBlocking {
+ public:
+  ScopedWorkerBlocking() : observer_(WorkerBlockingObserver::Current()) {
+    if (observer_) observer_->OnWorkerBlocked();
+  }
+  ~ScopedWorkerBlocking() {
+    if (observer_) observer_->OnWorkerUnblocked();
+  }
+  ScopedWorkerBlocking(const ScopedWorkerBlocking&) = delete;
+  ScopedWorkerBlocking& operator=(const ScopedWorkerBlocking&) = delete;
+
+ private:
+  WorkerBlockingObserver* observer_;
+};  // class ScopedWorkerBlocking
+
+/**
+ * @brief 在 worker 中等待 future (如资源 ticket), 未就绪时计为阻塞
+ */
+template <typename FutureT>
+void WaitInWorker(const FutureT& future) {
+  if (future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) return;
+  ScopedWorkerBlocking blocking;
+  future.wait();
+}
+
+
+#endif  // WORKER_BLOCKING_HPP_
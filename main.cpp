@@ -1,83 +1,172 @@
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
 #include <vector>
 #include <mutex>
 #include <memory>
 #include <future>
 
+#include "cpu_affinity.hpp"
+#include "frame_buffer_pool.hpp"
+#include "frame_result_cache.hpp"
 #include "infer_resource.hpp"
 #include "batching_stage.hpp"
 #include "batching_done_stage.hpp"
+#include "infer_backend_dispatcher.hpp"
+#include "infer_pipeline.hpp"
 #include "infer_thread_pool.hpp"
 #include "infer_trans_data_helper.hpp"
+#include "memory_budget_manager.hpp"
+#include "pipeline_simulator.hpp"
+#include "result_sink.hpp"
+#include "run_modes.hpp"
 
 
 uint32_t batchsize = 4;
 
-auto cpu_input_res_ = std::make_shared<IOResource>(batchsize);
-auto cpu_output_res_ = std::make_shared<IOResource>(batchsize);
-auto mlu_input_res_ = std::make_shared<IOResource>(batchsize);
-auto mlu_output_res_ = std::make_shared<IOResource>(batchsize);
+// 输入尺寸分桶, 每个尺寸桶独占 cpu 输入缓冲, device 输入缓冲按最大尺寸分配
+std::vector<FrameShape> frame_shapes_ = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+uint32_t bucket_max_wait_ms_ = 200;
 
-auto batching_stage_ = std::make_shared<IOBatchingStage>(batchsize, cpu_input_res_);
+// 预测 CPU 先于 device 完成的批次改走 CPU 后端, 另占 CPU 专用缓冲; 由 --cpu-fallback 启用
+bool enable_cpu_fallback_ = false;
 
-std::vector<std::shared_ptr<BatchingDoneStage>> batching_done_stages_ =
-{ std::make_shared<H2DBatchingDoneStage>(batchsize, cpu_input_res_, mlu_input_res_),
- std::make_shared<InferBatchingDoneStage>(batchsize, mlu_input_res_, mlu_output_res_),
- std::make_shared<D2HBatchingDoneStage>(batchsize, mlu_output_res_, cpu_output_res_),
- std::make_shared<PostprocessingBatchingDoneStage>(batchsize, cpu_output_res_) };
+// 线程池 worker 与 IO 资源缓冲放在同一 NUMA 节点, 使批次各阶段访问本地内存; 由 --numa-node <n> 启用, -1 表示不绑定
+int numa_node_ = -1;
 
-BatchingDoneInput batched_finfos_{ };
-auto tp_ = std::make_shared<InferThreadPool>();
+auto tp_ = std::make_shared<InferThreadPool>("shared");
+
+// 独立 worker 组: CPU 密集阶段与 device 阶段各用一个有界队列, 前后处理任务堆积时不会阻塞 H2D/推理任务的提交;
+// 由 --worker-groups 启用, 默认所有阶段共用 tp_
+bool dedicated_worker_groups_ = false;
+auto cpu_tp_ = std::make_shared<InferThreadPool>("cpu");
+auto device_tp_ = std::make_shared<InferThreadPool>("device");
+
+// 弹性线程池: 所有 worker 阻塞且有任务等待时扩容, 空闲超时的 worker 退出; 初始线程数作为下限. 由 --elastic 启用
+bool elastic_thread_pool_ = false;
+size_t elastic_min_threads_ = 2;
+size_t elastic_max_threads_ = 64;
+uint32_t elastic_idle_timeout_ms_ = 2000;
+
+// 热重配暂停上限
+uint32_t max_reconfigure_pause_ms_ = 5000;
+
+std::shared_ptr<InferPipeline> pipeline_;
+
+// 级联: 检测流水线 (pipeline_) 每帧输出 0 ~ max_objects_per_frame_ 个目标, 裁剪后送入分类流水线跨帧组批
+uint32_t classifier_batchsize_ = 8;
+FrameShape classifier_shape_ = { 224, 224 };
+uint32_t max_objects_per_frame_ = 3;
+std::shared_ptr<InferPipeline> classifier_pipeline_;
 auto trans_helper_ = std::make_shared<InferTransDataHelper>(batchsize);
 
+// 结果去重缓存, 由 --dedup 启用; 感知哈希模式下汉明距离不超过 4 的帧视为重复
+size_t result_cache_bytes_ = 4 << 20;
+uint32_t result_cache_max_distance_ = 4;
+
+// IO 缓冲内存预算, 由 --memory-budget <MB> 启用并设置全局上限, 所有流水线共用; device 池另有上限
+size_t device_memory_cap_bytes_ = 128 << 20;
+std::shared_ptr<MemoryBudgetManager> memory_budget_;
+
+// 结果落盘, 由 --sink <path> 启用; 最多占用 4 块 1MB 的写缓冲
+size_t result_sink_buffer_bytes_ = 1 << 20;
+uint32_t result_sink_buffers_ = 4;
+std::shared_ptr<ResultSink> result_sink_;
+
+// --record 写出的合成录制文件: 帧数, 按 frame_shapes_ 轮流取尺寸, 30fps 时间戳
+uint32_t record_frames_ = 16;
+int64_t record_frame_interval_us_ = 33333;
+
+// 帧数据缓冲池, 空闲缓冲最多缓存 64MB
+auto frame_buffer_pool_ = FrameBufferPool::Create(64 << 20);
+
 int64_t current_ms() {
   return std::chrono::duration_cast<std::chrono::milliseconds>(
     std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
+std::shared_ptr<InferThreadPool> GetThreadPool(WorkerGroup group) {
+  if (!dedicated_worker_groups_) return tp_;
+  return (group == WorkerGroup::kDeviceBound) ? device_tp_ : cpu_tp_;
+}
+
+size_t SharedThreadNum(uint32_t bs) { return bs * 3 + 4; }
+// 两组之和与共享线程池相同; device 组至少 3 个线程, 分块模式下 H2D/推理/D2H 需同时运行
+size_t CpuGroupThreadNum(uint32_t bs) { return bs * 2 + 2; }
+size_t DeviceGroupThreadNum(uint32_t bs) { return bs + 2; }
+
+void InitThreadPools(uint32_t bs) {
+  std::vector<int> cpus = GetNumaNodeCpus(numa_node_);
+  if (elastic_thread_pool_) {
+    for (auto& tp : { tp_, cpu_tp_, device_tp_ }) tp->SetElastic(elastic_max_threads_, elastic_idle_timeout_ms_);
+  }
+  if (dedicated_worker_groups_) {
+    cpu_tp_->Init(elastic_thread_pool_ ? elastic_min_threads_ : CpuGroupThreadNum(bs), cpus);
+    device_tp_->Init(elastic_thread_pool_ ? elastic_min_threads_ : DeviceGroupThreadNum(bs), cpus);
+  } else {
+    tp_->Init(elastic_thread_pool_ ? elastic_min_threads_ : SharedThreadNum(bs), cpus);
+  }
+}
+
 /**
- * @brief 攒够一个批次的数据，进行处理
+ * @brief 按新 batchsize 调整线程数, 在流水线排空时调用
+ * 弹性线程池的下限不随 batchsize 变化, 由负载自行扩缩, 不做调整
  */
-void BatchingDone() {
-  batching_stage_->Reset();
-  if (!batched_finfos_.empty()) {
-    for (auto& it : batching_done_stages_) {
-      auto tasks = it->BatchingDone(batched_finfos_);
-      tp_->SubmitTask(tasks);
-    }
-    batched_finfos_.clear();
+void ResizeThreadPools(uint32_t bs) {
+  if (elastic_thread_pool_) return;
+  if (dedicated_worker_groups_) {
+    cpu_tp_->Resize(CpuGroupThreadNum(bs));
+    device_tp_->Resize(DeviceGroupThreadNum(bs));
+  } else {
+    tp_->Resize(SharedThreadNum(bs));
   }
 }
 
 ResultWaitingCard FeedData(std::shared_ptr<FrameInfo> finfo) {
-    auto ret_promise = std::make_shared<std::promise<void>>();
-    ResultWaitingCard card(ret_promise);
-    auto auto_set_done = std::make_shared<AutoSetDone>(ret_promise, finfo);
-
-    InferTaskSptr task = batching_stage_->Batching(finfo);
-    tp_->SubmitTask(task);
-
-    batched_finfos_.push_back(std::make_pair(finfo, auto_set_done));
-    if (batched_finfos_.size() == batchsize) {
-        BatchingDone();
-    }
-    return card;
+  return pipeline_->FeedData(finfo);
 }
 
-int main() {
-  tp_->Init(batchsize * 3 + 4);
+void PrintBackendCounters() {
+  const std::pair<InferBackend, const char*> backends[] = {
+    { InferBackend::kDevice, "device" }, { InferBackend::kCpu, "cpu" } };
+  for (const auto& it : backends) {
+    InferBackendDispatcher::Counters counters = pipeline_->GetDispatcher()->GetCounters(it.first);
+    std::cout << "Backend " << it.second << ": batches " << counters.batches
+        << ", done " << counters.done << ", inflight " << counters.inflight
+        << ", service " << counters.service_ms << " ms" << std::endl;
+  }
+}
 
-  cpu_input_res_->Init();
-  cpu_output_res_->Init();
-  mlu_input_res_->Init();
-  mlu_output_res_->Init();
+void PrintThreadPoolStats() {
+  for (auto& tp : { tp_, cpu_tp_, device_tp_ }) {
+    InferThreadPool::Stats stats = tp->GetStats();
+    if (0 == stats.submitted) continue;
+    std::cout << "Thread pool " << tp->GetName() << ": threads " << stats.thread_num
+        << ", submitted " << stats.submitted << ", queue " << stats.queue_size << "/" << stats.queue_capacity
+        << ", queue hwm " << stats.queue_hwm << ", blocked submits " << stats.blocked_submits
+        << ", blocked " << stats.blocked_ms << " ms, peak threads " << stats.peak_thread_num
+        << ", spawned " << stats.spawned << ", retired " << stats.retired << std::endl;
+  }
+}
 
-  int num_batch = 4;
-  for (int i = 0; i < num_batch; i++) {
-    for (int j = 0; j < batchsize; ++j) {
+void FeedSyntheticBatches(int first_batch, int num_batch) {
+  uint32_t bs = pipeline_->GetBatchsize();
+  for (int i = first_batch; i < first_batch + num_batch; i++) {
+    for (uint32_t j = 0; j < bs; ++j) {
       std::shared_ptr<FrameInfo> finfo = std::make_shared<FrameInfo>();
       finfo->batch_index = i;
       finfo->item_index = j;
+      finfo->shape = { 1920, 1080 };
+      finfo->payload = frame_buffer_pool_->Acquire(finfo->shape.Bytes());
+      std::memset(finfo->payload->mutable_data(), i * bs + j, finfo->payload->size());
       ResultWaitingCard card = FeedData(finfo);
 
       // TODO: 人为制造的延迟 便于打印
@@ -87,7 +176,331 @@ int main() {
       trans_helper_->SubmitData(std::make_pair(finfo, card));
     }
   }
-  std::this_thread::sleep_for(std::chrono::seconds(10));
+}
+
+/**
+ * @param reconfig_batchsize 非 0 时, 送完数据后热重配为该 batchsize 并再送一轮
+ */
+void RunSynthetic(uint32_t reconfig_batchsize) {
+  auto start = std::chrono::steady_clock::now();
+  int num_batch = 4;
+  uint64_t num_frames = pipeline_->GetBatchsize() * num_batch;
+  FeedSyntheticBatches(0, num_batch);
+  if (reconfig_batchsize > 0) {
+    double pause_ms = pipeline_->Reconfigure(reconfig_batchsize, max_reconfigure_pause_ms_,
+                                             [reconfig_batchsize]() { ResizeThreadPools(reconfig_batchsize); });
+    std::cout << "Reconfigure batchsize to " << reconfig_batchsize << ", pause " << pause_ms << " ms" << std::endl;
+    // 批次序号接在已送帧数之后, 使 batch_index * batchsize + item_index 在重配前后不重复
+    uint32_t bs = pipeline_->GetBatchsize();
+    int first_batch = static_cast<int>((num_frames + bs - 1) / bs);
+    num_frames += bs * num_batch;
+    FeedSyntheticBatches(first_batch, num_batch);
+  }
+  pipeline_->Flush();
+  trans_helper_->WaitForProcessed(num_frames);
+  std::cout << "Synthetic run: " << num_frames << " frames in "
+      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms"
+      << std::endl;
+}
+
+/**
+ * @brief 分类桶的组批超时: 子帧按检测批次成批到达, 间隔为检测流水线的批次周期 (device 上最慢阶段处理一批的耗时),
+ * 超时取攒满一个分类批次平均所需的检测批次数再加一个周期的余量, 使子帧能跨父帧批次凑满
+ */
+uint32_t ClassifierMaxWaitMs(uint32_t detector_batchsize) {
+  uint32_t period_ms = std::max({ H2DBatchingDoneStage::kServiceMs, InferBatchingDoneStage::kServiceMs,
+                                  D2HBatchingDoneStage::kServiceMs });
+  // 每帧平均 max_objects_per_frame_ / 2 个目标
+  uint32_t children_x2 = std::max(1u, detector_batchsize * max_objects_per_frame_);
+  uint32_t periods = (classifier_batchsize_ * 2 + children_x2 - 1) / children_x2 + 1;
+  return periods * period_ms;
+}
+
+/**
+ * @brief 模拟检测结果: 按帧序号产生若干目标, 每个目标从父帧数据中裁剪一块作为分类输入
+ */
+std::vector<std::shared_ptr<FrameInfo>> DetectObjects(const FrameInfo& parent) {
+  std::vector<std::shared_ptr<FrameInfo>> objects;
+  // 父帧所属批次的 batchsize: 热重配在排空检测流水线后才切换, 排空期间仍为原值
+  uint32_t parent_index = parent.batch_index * pipeline_->GetBatchsize() + parent.item_index;
+  uint32_t num = parent_index % (max_objects_per_frame_ + 1);
+  for (uint32_t i = 0; i < num; ++i) {
+    auto child = std::make_shared<FrameInfo>();
+    child->batch_index = parent_index;  // 父帧序号
+    child->item_index = i;
+    child->shape = classifier_shape_;
+    child->pts_us = parent.pts_us;
+    child->payload = frame_buffer_pool_->Acquire(classifier_shape_.Bytes());
+    if (parent.payload) {
+      size_t offset = i * classifier_shape_.Bytes() % std::max<size_t>(1, parent.payload->size());
+      size_t bytes = std::min(classifier_shape_.Bytes(), parent.payload->size() - offset);
+      std::memcpy(child->payload->mutable_data(), parent.payload->data() + offset, bytes);
+    }
+    objects.push_back(child);
+  }
+  return objects;
+}
+
+void PrintBucketStats(const std::shared_ptr<InferPipeline>& pipeline, const std::string& name) {
+  for (const auto& stats : pipeline->GetBucketStats()) {
+    std::cout << name << " bucket " << stats.shape.width << "x" << stats.shape.height << ": frames " << stats.frames
+        << ", batches " << stats.batches << ", timeout flushes " << stats.timeout_flushes
+        << ", padded slots " << stats.padded_slots << ", padding " << stats.padding_bytes << " B"
+        << ", buffers " << stats.buffer_num << " (" << stats.buffer_bytes << " B)" << std::endl;
+  }
+}
+
+void PrintFrameBufferPoolStats() {
+  FrameBufferPool::Stats stats = frame_buffer_pool_->GetStats();
+  if (0 == stats.acquires) return;
+  std::cout << "Frame buffer pool: acquires " << stats.acquires << ", hit rate " << stats.HitRate()
+      << ", outstanding " << stats.outstanding_bytes << " B, high water " << stats.high_water_bytes
+      << " B, cached " << stats.cached_bytes << " B" << std::endl;
+}
+
+void PrintResultCacheStats() {
+  auto cache = pipeline_->GetResultCache();
+  if (!cache) return;
+  FrameResultCache::Stats stats = cache->GetStats();
+  std::cout << "Result cache: lookups " << stats.lookups << ", hits " << stats.hits
+      << ", coalesced " << stats.coalesced << ", hit rate " << stats.HitRate() << ", entries " << stats.entries << " (" << stats.bytes << " B), evictions " << stats.evictions << std::endl;
+}
+
+void PrintMemoryBudgetStats() {
+  if (!memory_budget_) return;
+  MemoryBudgetManager::Stats stats = memory_budget_->GetStats();
+  std::cout << "Memory budget: " << stats.reserved_bytes << "/" << stats.global_cap_bytes << " B, peak "
+      << stats.peak_bytes << " B" << std::endl;
+  for (MemoryPool pool : { MemoryPool::kHost, MemoryPool::kDevice }) {
+    const auto& pool_stats = stats.pools[static_cast<int>(pool)];
+    std::cout << "  " << MemoryBudgetManager::PoolName(pool) << ": " << pool_stats.usage.reserved_bytes << "/"
+        << pool_stats.cap_bytes << " B in " << pool_stats.usage.buffers << " buffers, peak " << pool_stats.peak_bytes
+        << " B, fragmentation " << pool_stats.Fragmentation() << ", rejections " << pool_stats.rejections << std::endl;
+  }
+  for (const auto& it : stats.resources) {
+    std::cout << "  " << it.first << ": " << it.second.buffers << " x "
+        << it.second.requested_bytes / it.second.buffers << " B" << std::endl;
+  }
+}
+
+/**
+ * @brief 关闭结果文件并输出写入统计, 再流式读回校验记录数
+ */
+bool CloseResultSink(const std::string& path) {
+  if (!result_sink_) return true;
+  bool io_uring = result_sink_->UsingIoUring();
+  result_sink_->Close();
+  ResultSink::Stats stats = result_sink_->GetStats();
+  std::cout << "Result sink: " << stats.records << " records, " << stats.bytes << " B in " << stats.buffers
+      << " buffers, " << stats.MBps() << " MB/s, io " << stats.IoMBps() << " MB/s, stalls " << stats.stalls
+      << ", write errors " << stats.write_errors << " (" << (io_uring ? "io_uring" : "pwrite") << ")" << std::endl;
+
+  ResultSinkReader reader(path);
+  if (!reader.Open()) return false;
+  uint64_t records = 0;
+  uint64_t children = 0;
+  ResultSinkReader::Record record;
+  while (reader.Next(&record)) {
+    records++;
+    children += record.children.size();
+  }
+  bool ok = !reader.Corrupted() && records == stats.records && 0 == stats.write_errors;
+  std::cout << "Result file: " << records << " records, " << children << " children"
+      << (ok ? "" : ", mismatch") << (reader.Corrupted() ? ", corrupted" : "") << std::endl;
+  return ok;
+}
+
+/**
+ * @brief 线程配置与 InitThreadPools 一致
+ */
+void SetSimThreads(SimConfig* config) {
+  config->dedicated_worker_groups = dedicated_worker_groups_;
+  if (elastic_thread_pool_) {
+    config->shared_threads = config->cpu_threads = config->device_threads = elastic_min_threads_;
+    config->max_threads = elastic_max_threads_;
+  } else {
+    config->shared_threads = SharedThreadNum(config->batchsize);
+    config->cpu_threads = CpuGroupThreadNum(config->batchsize);
+    config->device_threads = DeviceGroupThreadNum(config->batchsize);
+    config->max_threads = 0;
+  }
+}
+
+/**
+ * @brief 解析十进制无符号整数参数
+ * @return 不是完整的十进制数或不在 [min_value, max_value] 内时返回 false, 不修改 value; max_value 不能为负
+ */
+template <typename T>
+bool ParseUint(const char* str, T* value, T min_value = 0, T max_value = std::numeric_limits<T>::max()) {
+  if (!std::isdigit(static_cast<unsigned char>(str[0]))) return false;  // strtoull 接受前导空白与负号
+  errno = 0;
+  char* end = nullptr;
+  unsigned long long v = std::strtoull(str, &end, 10);
+  if (0 != errno || '\0' != *end || v > static_cast<unsigned long long>(max_value)) return false;
+  // 不超过 max_value 的值可由 T 表示, 转换后按 T 比较下限, 避免有符号 T 与 unsigned long long 比较
+  if (static_cast<T>(v) < min_value) return false;
+  *value = static_cast<T>(v);
+  return true;
+}
+
+/**
+ * @return 不是完整的有限正数时返回 false, 不修改 value
+ */
+bool ParsePositiveDouble(const char* str, double* value) {
+  errno = 0;
+  char* end = nullptr;
+  double v = std::strtod(str, &end);
+  if (end == str || '\0' != *end || 0 != errno || !std::isfinite(v) || v <= 0) return false;
+  *value = v;
+  return true;
+}
+
+void PrintUsage(const char* prog) {
+  std::cout << "Usage: " << prog
+      << " [--record <record file>] [--replay <record file> [--realtime]] [--reconfigure <batchsize>]"
+      << " [--dedup exact|perceptual] [--simulate <fps>] [--stress <batches>]"
+      << " [--cascade] [--chunk <items>] [--memory-budget <MB>] [--sink <result file>] [--numa-node <node>]"
+      << " [--worker-groups] [--elastic] [--cpu-fallback]"
+      << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::string record_path;
+  std::string replay_path;
+  bool replay_realtime = false;
+  uint32_t reconfig_batchsize = 0;
+  std::string dedup_mode;
+  double simulate_fps = 0;
+  uint32_t stress_batches = 0;
+  bool cascade = false;
+  uint32_t chunk_items = 0;
+  size_t memory_budget_mb = 0;
+  std::string sink_path;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool ok = true;
+    if (arg == "--record" && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (arg == "--replay" && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (arg == "--realtime") {
+      replay_realtime = true;
+    } else if (arg == "--reconfigure" && i + 1 < argc) {
+      ok = ParseUint(argv[++i], &reconfig_batchsize, 1u);
+    } else if (arg == "--dedup" && i + 1 < argc && (argv[i + 1] == std::string("exact") ||
+                                                     argv[i + 1] == std::string("perceptual"))) {
+      dedup_mode = argv[++i];
+    } else if (arg == "--simulate" && i + 1 < argc) {
+      ok = ParsePositiveDouble(argv[++i], &simulate_fps);
+    } else if (arg == "--stress" && i + 1 < argc) {
+      ok = ParseUint(argv[++i], &stress_batches, 1u);
+    } else if (arg == "--cascade") {
+      cascade = true;
+    } else if (arg == "--chunk" && i + 1 < argc) {
+      ok = ParseUint(argv[++i], &chunk_items);
+    } else if (arg == "--memory-budget" && i + 1 < argc) {
+      ok = ParseUint(argv[++i], &memory_budget_mb, size_t(1), std::numeric_limits<size_t>::max() >> 20);
+    } else if (arg == "--sink" && i + 1 < argc) {
+      sink_path = argv[++i];
+    } else if (arg == "--worker-groups") {
+      dedicated_worker_groups_ = true;
+    } else if (arg == "--elastic") {
+      elastic_thread_pool_ = true;
+    } else if (arg == "--cpu-fallback") {
+      enable_cpu_fallback_ = true;
+    } else if (arg == "--numa-node" && i + 1 < argc) {
+      ok = ParseUint(argv[++i], &numa_node_, 0, std::numeric_limits<int>::max()) && !GetNumaNodeCpus(numa_node_).empty();
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::cout << "Invalid argument: " << argv[i] << std::endl;
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (simulate_fps > 0) {
+    // 缓冲份数只在启用内存预算时才能加深
+    SimConfig sim_config;
+    sim_config.batchsize = batchsize;
+    sim_config.max_buffer_depth = memory_budget_mb > 0 ? InferPipelineConfig().max_buffer_depth : 1;
+    sim_config.bucket_max_wait_ms = bucket_max_wait_ms_;
+    std::vector<std::string> unmodelled_options;
+    if (chunk_items > 0) unmodelled_options.push_back("--chunk");
+    if (enable_cpu_fallback_) unmodelled_options.push_back("--cpu-fallback");
+    if (!dedup_mode.empty()) unmodelled_options.push_back("--dedup");
+    if (cascade) unmodelled_options.push_back("--cascade");
+    RunSimulation(simulate_fps, sim_config, SetSimThreads, unmodelled_options);
+    return 0;
+  }
+  if (!record_path.empty()) {
+    return RunRecord(record_path, frame_shapes_, record_frames_, record_frame_interval_us_) ? 0 : 1;
+  }
+
+  InitThreadPools(batchsize);
+
+  InferPipelineConfig config;
+  config.batchsize = batchsize;
+  config.frame_shapes = frame_shapes_;
+  config.bucket_max_wait_ms = bucket_max_wait_ms_;
+  config.enable_cpu_fallback = enable_cpu_fallback_;
+  config.numa_node = numa_node_;
+  config.name = "Detector";
+  config.transfer_chunk_items = chunk_items;
+  if (memory_budget_mb > 0) {
+    memory_budget_ = std::make_shared<MemoryBudgetManager>(memory_budget_mb << 20);
+    memory_budget_->SetPoolCap(MemoryPool::kDevice, device_memory_cap_bytes_);
+    config.memory_budget = memory_budget_;
+  }
+  if (!dedup_mode.empty()) {
+    config.result_cache_bytes = result_cache_bytes_;
+    config.result_cache_mode = (dedup_mode == "exact") ? FrameResultCache::HashMode::kExact
+                                                       : FrameResultCache::HashMode::kPerceptual;
+    config.result_cache_max_distance = result_cache_max_distance_;
+  }
+  bool pass = true;
+  if (stress_batches > 0) {
+    pass = RunStress(config, stress_batches, GetThreadPool, max_reconfigure_pause_ms_, frame_buffer_pool_, &pipeline_);
+  } else {
+    pipeline_ = std::make_shared<InferPipeline>(config, GetThreadPool);
+    bool initialized = true;
+    if (cascade) {
+      InferPipelineConfig classifier_config = config;
+      classifier_config.name = "Classifier";
+      classifier_config.batchsize = classifier_batchsize_;
+      classifier_config.frame_shapes = { classifier_shape_ };
+      classifier_config.bucket_max_wait_ms = ClassifierMaxWaitMs(batchsize);
+      classifier_pipeline_ = std::make_shared<InferPipeline>(classifier_config, GetThreadPool);
+      initialized = classifier_pipeline_->Init();
+      pipeline_->SetDownstream(classifier_pipeline_, DetectObjects);
+    }
+    initialized = pipeline_->Init() && initialized;
+    if (initialized && !sink_path.empty()) {
+      result_sink_ = std::make_shared<ResultSink>(sink_path, result_sink_buffer_bytes_, result_sink_buffers_);
+      initialized = result_sink_->Open();
+      trans_helper_->SetResultSink(result_sink_);
+    }
+    if (!initialized) {
+      pass = false;
+    } else if (replay_path.empty()) {
+      RunSynthetic(reconfig_batchsize);
+    } else {
+      pass = RunReplay(replay_path, replay_realtime, pipeline_, trans_helper_);
+    }
+    pass = CloseResultSink(sink_path) && pass;
+  }
+  PrintBackendCounters();
+  PrintThreadPoolStats();
+  PrintBucketStats(pipeline_, "Detector");
+  if (classifier_pipeline_) PrintBucketStats(classifier_pipeline_, "Classifier");
+  PrintFrameBufferPoolStats();
+  PrintResultCacheStats();
+  PrintMemoryBudgetStats();
+  pipeline_->Destroy();
+  if (classifier_pipeline_) classifier_pipeline_->Destroy();
   tp_->Destroy();
+  cpu_tp_->Destroy();
+  device_tp_->Destroy();
   trans_helper_.reset();
-}
\ No newline at end of file
+  return pass ? 0 : 1;
+}
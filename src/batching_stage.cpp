@@ -1,8 +1,9 @@
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <iostream>
 #include <chrono>
-#include <thread>
 
 #include "infer_task.hpp"
 #include "batching_stage.hpp"
@@ -22,6 +23,7 @@ std::shared_ptr<InferTask> IOBatchingStage::Batching(std::shared_ptr<FrameInfo>
 
   std::shared_ptr<InferTask> task = std::make_shared<InferTask>([this, ticket, finfo, bidx]() -> int {
     QueuingTicket t = ticket;
+    WaitInWorker(t);
     IOResValue value = this->output_res_->WaitResourceByTicket(&t);
     this->ProcessOneFrame(finfo, bidx, value);
     this->output_res_->DeallingDone();
@@ -33,7 +35,15 @@ std::shared_ptr<InferTask> IOBatchingStage::Batching(std::shared_ptr<FrameInfo>
 
 
 void IOBatchingStage::ProcessOneFrame(std::shared_ptr<FrameInfo> finfo, uint32_t bidx, IOResValue& value) {
-  std::this_thread::sleep_for(std::chrono::milliseconds(50));
-  std::cout << "IOBatchingStage, bidx: " << bidx 
-      << "; ["<< finfo->batch_index << ", " << finfo->item_index << "] " << std::endl;
+  // 帧数据拷入 cpu 输入缓冲的第 bidx 个帧位, 回放时由此实际读取映射的文件页
+  if (finfo->payload && !value.datas.empty() && value.datas[0].buffer) {
+    const IOResValue::OneData& data = value.datas[0];
+    size_t bytes = std::min(finfo->payload->size(), data.item_bytes);
+    std::memcpy(data.buffer.get() + bidx * data.item_bytes, finfo->payload->data(), bytes);
+  }
+  clock_->SleepFor(std::chrono::milliseconds(kServiceMs));
+  if (verbose_) {
+    std::cout << "IOBatchingStage, bidx: " << bidx 
+        << "; ["<< finfo->batch_index << ", " << finfo->item_index << "] " << std::endl;
+  }
 }
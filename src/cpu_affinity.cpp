@@ -0,0 +1,72 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "cpu_affinity.hpp"
+
+
+std::vector<int> ParseCpuList(const std::string& cpulist) {
+  std::vector<int> cpus;
+  std::stringstream ss(cpulist);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty()) continue;
+    size_t dash = range.find('-');
+    try {
+      int first = std::stoi(range.substr(0, dash));
+      int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    } catch (std::exception& e) {
+      std::cout << "Invalid cpu list: " << cpulist << std::endl;
+      return {};
+    }
+  }
+  return cpus;
+}
+
+std::vector<int> GetNumaNodeCpus(int node) {
+  if (node < 0) return {};
+  std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  std::string cpulist;
+  if (!ifs.is_open() || !std::getline(ifs, cpulist)) return {};
+  return ParseCpuList(cpulist);
+}
+
+bool SetCurrentThreadAffinity(const std::vector<int>& cpus) {
+  if (cpus.empty()) return true;
+#ifdef __linux__
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &cpuset);
+  }
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+  if (ret != 0) {
+    std::cout << "Set thread affinity failed. Error code [" << ret << "]" << std::endl;
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void RunOnCpus(const std::vector<int>& cpus, const std::function<void()>& func) {
+  if (cpus.empty()) {
+    func();
+    return;
+  }
+  std::thread th([&cpus, &func]() {
+    SetCurrentThreadAffinity(cpus);
+    func();
+  });
+  th.join();
+}
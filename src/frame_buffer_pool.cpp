@@ -0,0 +1,59 @@
+#include <memory>
+#include <mutex>
+
+#include "frame_buffer_pool.hpp"
+
+
+size_t FrameBufferPool::SizeClass(size_t size) {
+  if (size <= kMinSizeClass) return kMinSizeClass;
+  size_t pow2 = kMinSizeClass;
+  while (pow2 < size) pow2 <<= 1;
+  size_t step = pow2 / 8;  // (pow2 / 2, pow2] 均分 4 级
+  return (size + step - 1) / step * step;
+}
+
+std::shared_ptr<FrameBuffer> FrameBufferPool::Acquire(size_t size) {
+  size_t size_class = SizeClass(size);
+  std::unique_ptr<FrameBuffer> buf;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    stats_.acquires++;
+    auto it = free_lists_.find(size_class);
+    if (it != free_lists_.end() && !it->second.empty()) {
+      buf = std::move(it->second.back());
+      it->second.pop_back();
+      stats_.hits++;
+      stats_.cached_bytes -= size_class;
+    }
+    stats_.outstanding_bytes += size_class;
+    if (stats_.outstanding_bytes > stats_.high_water_bytes) stats_.high_water_bytes = stats_.outstanding_bytes;
+  }
+  if (!buf) buf.reset(new FrameBuffer(size_class));
+  buf->set_size(size);
+
+  std::weak_ptr<FrameBufferPool> weak_pool = shared_from_this();
+  return std::shared_ptr<FrameBuffer>(buf.release(), [weak_pool](FrameBuffer* released) {
+    auto pool = weak_pool.lock();
+    if (pool) {
+      pool->Recycle(released);
+    } else {
+      delete released;
+    }
+  });
+}
+
+void FrameBufferPool::Recycle(FrameBuffer* buf) {
+  std::unique_ptr<FrameBuffer> holder(buf);
+  size_t size_class = buf->capacity();
+  std::lock_guard<std::mutex> lk(mtx_);
+  stats_.outstanding_bytes -= size_class;
+  if (stats_.cached_bytes + size_class <= max_cached_bytes_) {
+    free_lists_[size_class].push_back(std::move(holder));
+    stats_.cached_bytes += size_class;
+  }
+}
+
+FrameBufferPool::Stats FrameBufferPool::GetStats() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return stats_;
+}
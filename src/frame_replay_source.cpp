@@ -0,0 +1,135 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "frame_replay_source.hpp"
+
+
+struct FrameReplaySource::MappedRegion {
+  void* addr = nullptr;
+  size_t length = 0;
+  ~MappedRegion() {
+    if (addr) munmap(addr, length);
+  }
+};
+
+bool FrameReplaySource::Open() {
+  Close();
+  std::ifstream ifs(path_ + ".idx", std::ios::binary);
+  if (!ifs.is_open()) {
+    std::cout << "Open replay index failed: " << path_ << ".idx" << std::endl;
+    return false;
+  }
+  IndexHeader header;
+  if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != kIndexMagic) {
+    std::cout << "Not a replay index: " << path_ << ".idx" << std::endl;
+    return false;
+  }
+  if (header.version != kIndexVersion) {
+    std::cout << "Unsupported replay index version " << header.version << ": " << path_ << ".idx" << std::endl;
+    return false;
+  }
+  FrameIndexEntry entry;
+  while (ifs.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+    index_.push_back(entry);
+  }
+
+  int fd = open(path_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cout << "Open replay data failed: " << path_ << std::endl;
+    index_.clear();
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    index_.clear();
+    return false;
+  }
+  auto mapping = std::make_shared<MappedRegion>();
+  mapping->length = static_cast<size_t>(st.st_size);
+  if (mapping->length > 0) {
+    void* addr = mmap(nullptr, mapping->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      std::cout << "Map replay data failed: " << path_ << std::endl;
+      close(fd);
+      index_.clear();
+      return false;
+    }
+    mapping->addr = addr;
+    // 回放按顺序读取, 提示内核预读
+    madvise(mapping->addr, mapping->length, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  for (const auto& it : index_) {
+    if (it.offset > mapping->length || it.size > mapping->length - it.offset) {
+      std::cout << "Replay index out of range: offset " << it.offset << ", size " << it.size << std::endl;
+      index_.clear();
+      return false;
+    }
+  }
+  mapping_ = mapping;
+  return true;
+}
+
+void FrameReplaySource::Close() {
+  index_.clear();
+  mapping_.reset();  // 仍在流水线中的帧持有映射引用, 不会被提前 munmap
+}
+
+size_t FrameReplaySource::Replay(uint32_t batchsize, bool realtime,
+                                 const std::function<void(std::shared_ptr<FrameInfo>)>& feed) {
+  if (!mapping_ || 0 == batchsize) return 0;
+  const uint8_t* base = static_cast<const uint8_t*>(mapping_->addr);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t fidx = 0; fidx < index_.size(); ++fidx) {
+    const FrameIndexEntry& entry = index_[fidx];
+    if (realtime) {
+      std::this_thread::sleep_until(start + std::chrono::microseconds(entry.pts_us - index_[0].pts_us));
+    }
+    std::shared_ptr<FrameInfo> finfo = std::make_shared<FrameInfo>();
+    finfo->batch_index = static_cast<uint32_t>(fidx / batchsize);
+    finfo->item_index = static_cast<uint32_t>(fidx % batchsize);
+    finfo->pts_us = entry.pts_us;
+    finfo->shape = { entry.width, entry.height };
+    finfo->payload = std::make_shared<FrameBuffer>(base + entry.offset, entry.size, mapping_);
+    feed(finfo);
+  }
+  return index_.size();
+}
+
+bool FrameReplaySource::Record(const std::string& path, const std::vector<std::vector<uint8_t>>& frames,
+                               const std::vector<int64_t>& pts_us, const std::vector<FrameShape>& shapes) {
+  if (frames.size() != pts_us.size() || frames.size() != shapes.size()) return false;
+  std::ofstream data_ofs(path, std::ios::binary | std::ios::trunc);
+  std::ofstream index_ofs(path + ".idx", std::ios::binary | std::ios::trunc);
+  if (!data_ofs.is_open() || !index_ofs.is_open()) {
+    std::cout << "Open record file failed: " << path << std::endl;
+    return false;
+  }
+  IndexHeader header;
+  index_ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  uint64_t offset = 0;
+  for (size_t fidx = 0; fidx < frames.size(); ++fidx) {
+    FrameIndexEntry entry;
+    entry.offset = offset;
+    entry.size = frames[fidx].size();
+    entry.pts_us = pts_us[fidx];
+    entry.width = shapes[fidx].width;
+    entry.height = shapes[fidx].height;
+    data_ofs.write(reinterpret_cast<const char*>(frames[fidx].data()), frames[fidx].size());
+    index_ofs.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    offset += entry.size;
+  }
+  return data_ofs.good() && index_ofs.good();
+}
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include "frame_result_cache.hpp"
+
+
+/**
+ * @brief 64 位内容哈希, 4 路独立累加便于编译器展开与向量化
+ */
+uint64_t FrameResultCache::ExactHash(const uint8_t* data, size_t size) {
+  const uint64_t kMul = 0x9E3779B97F4A7C15ULL;
+  uint64_t lanes[4] = { size, kMul, ~static_cast<uint64_t>(size), 0x632BE59BD9B4E019ULL };
+  size_t pos = 0;
+  for (; pos + 32 <= size; pos += 32) {
+    uint64_t words[4];
+    std::memcpy(words, data + pos, sizeof(words));
+    for (int lane = 0; lane < 4; ++lane) {
+      lanes[lane] = (lanes[lane] ^ words[lane]) * kMul;
+      lanes[lane] ^= lanes[lane] >> 32;
+    }
+  }
+  uint64_t hash = lanes[0] ^ (lanes[1] << 1) ^ (lanes[2] << 2) ^ (lanes[3] << 3);
+  for (; pos < size; ++pos) {
+    hash = (hash ^ data[pos]) * kMul;
+  }
+  hash ^= hash >> 29;
+  return hash;
+}
+
+/**
+ * @brief 亮度平面 8x8 分块均值哈希
+ * 每个分块最多采样 8 行, 行内连续累加 (可被编译器向量化), 4K 帧也只读取约 1/16 的亮度数据
+ */
+FrameResultCache::FrameDigest FrameResultCache::PerceptualHash(const uint8_t* luma, uint32_t width,
+                                                               uint32_t height) {
+  FrameDigest digest;
+  if (!luma || width < 8 || height < 8) return digest;
+  uint64_t sums[64] = { 0 };
+  uint64_t counts[64] = { 0 };
+  for (uint32_t by = 0; by < 8; ++by) {
+    uint32_t y0 = by * height / 8;
+    uint32_t y1 = (by + 1) * height / 8;
+    uint32_t step = std::max(1u, (y1 - y0) / 8);
+    for (uint32_t y = y0; y < y1; y += step) {
+      const uint8_t* row = luma + static_cast<size_t>(y) * width;
+      for (uint32_t bx = 0; bx < 8; ++bx) {
+        uint32_t x0 = bx * width / 8;
+        uint32_t x1 = (bx + 1) * width / 8;
+        uint32_t sum = 0;
+        for (uint32_t x = x0; x < x1; ++x) sum += row[x];
+        sums[by * 8 + bx] += sum;
+        counts[by * 8 + bx] += x1 - x0;
+      }
+    }
+  }
+  uint64_t means[64];
+  uint64_t total = 0;
+  for (int i = 0; i < 64; ++i) {
+    means[i] = sums[i] / counts[i];
+    total += means[i];
+  }
+  uint64_t global_mean = total / 64;
+  for (int i = 0; i < 64; ++i) {
+    if (means[i] > global_mean) digest.hash |= (1ULL << i);
+  }
+  digest.luma = static_cast<uint8_t>(global_mean);
+  digest.valid = true;
+  return digest;
+}
+
+FrameResultCache::FrameDigest FrameResultCache::ComputeDigest(const FrameInfo& finfo) const {
+  FrameDigest digest;
+  if (!finfo.payload || !finfo.payload->data()) return digest;
+  const FrameBuffer& payload = *finfo.payload;
+  size_t luma_bytes = static_cast<size_t>(finfo.shape.width) * finfo.shape.height;
+  if (mode_ == HashMode::kPerceptual && luma_bytes > 0 && payload.size() >= luma_bytes) {
+    return PerceptualHash(payload.data(), finfo.shape.width, finfo.shape.height);
+  }
+  // 精确模式, 或尺寸未知无法定位亮度平面
+  digest.hash = ExactHash(payload.data(), payload.size());
+  digest.valid = true;
+  return digest;
+}
+
+bool FrameResultCache::Match(const FrameDigest& lhs, const FrameDigest& rhs) const {
+  if (mode_ == HashMode::kExact) return lhs.hash == rhs.hash;
+  const int kMaxLumaDiff = 4;
+  if (std::abs(static_cast<int>(lhs.luma) - static_cast<int>(rhs.luma)) > kMaxLumaDiff) return false;
+  return std::bitset<64>(lhs.hash ^ rhs.hash).count() <= max_distance_;
+}
+
+/**
+ * @brief 第 band 段的索引键: 段号放在高 32 位, 段宽不超过 32 位 (至少分 2 段)
+ */
+uint64_t FrameResultCache::BandKey(uint64_t hash, uint32_t band) const {
+  uint32_t begin = band * 64 / bands_;
+  uint32_t end = (band + 1) * 64 / bands_;
+  uint64_t mask = (end - begin >= 64) ? ~0ULL : ((1ULL << (end - begin)) - 1);
+  return (static_cast<uint64_t>(band) << 32) | ((hash >> begin) & mask);
+}
+
+void FrameResultCache::AddToBands(std::list<Entry>::iterator entry) {
+  for (uint32_t band = 0; band < bands_; ++band) {
+    band_index_.emplace(BandKey(entry->digest.hash, band), entry);
+  }
+}
+
+void FrameResultCache::RemoveFromBands(std::list<Entry>::iterator entry) {
+  for (uint32_t band = 0; band < bands_; ++band) {
+    auto range = band_index_.equal_range(BandKey(entry->digest.hash, band));
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == entry) {
+        band_index_.erase(it);
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * @brief 移除条目及其索引, 需持有 mtx_
+ */
+void FrameResultCache::Erase(std::list<Entry>::iterator entry) {
+  stats_.bytes -= EntryBytes(*entry);
+  RemoveFromBands(entry);
+  index_.erase(Key(entry->digest));
+  lru_.erase(entry);
+}
+
+bool FrameResultCache::Lookup(const FrameDigest& digest, std::vector<uint8_t>* result) {
+  if (!digest.valid) return false;
+  std::lock_guard<std::mutex> lk(mtx_);
+  stats_.lookups++;
+  auto found = lru_.end();
+  auto it = index_.find(Key(digest));
+  if (it != index_.end() && Match(digest, it->second->digest)) {
+    found = it->second;
+  } else if (bands_ > 0) {
+    // 只比较至少有一段相同的候选, 取汉明距离最小者
+    size_t best_distance = 65;
+    for (uint32_t band = 0; band < bands_; ++band) {
+      auto range = band_index_.equal_range(BandKey(digest.hash, band));
+      for (auto candidate = range.first; candidate != range.second; ++candidate) {
+        const FrameDigest& other = candidate->second->digest;
+        size_t distance = std::bitset<64>(digest.hash ^ other.hash).count();
+        if (distance < best_distance && Match(digest, other)) {
+          found = candidate->second;
+          best_distance = distance;
+        }
+      }
+    }
+  } else if (mode_ == HashMode::kPerceptual && max_distance_ > 0) {
+    // max_distance 不小于 64 时任意哈希都满足距离要求, 只需比较亮度, 最近使用的条目通常即可命中
+    for (auto entry = lru_.begin(); entry != lru_.end(); ++entry) {
+      if (Match(digest, entry->digest)) {
+        found = entry;
+        break;
+      }
+    }
+  }
+  if (found == lru_.end()) return false;
+  lru_.splice(lru_.begin(), lru_, found);
+  stats_.hits++;
+  if (result) *result = found->result;
+  return true;
+}
+
+void FrameResultCache::Insert(const FrameDigest& digest, const std::vector<uint8_t>& result) {
+  if (!digest.valid) return;
+  Entry entry;
+  entry.digest = digest;
+  entry.result = result;
+  if (EntryBytes(entry) > max_bytes_) return;
+
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = index_.find(Key(digest));
+  if (it != index_.end()) Erase(it->second);
+  stats_.bytes += EntryBytes(entry);
+  lru_.push_front(std::move(entry));
+  index_[Key(digest)] = lru_.begin();
+  AddToBands(lru_.begin());
+  stats_.insertions++;
+
+  while (stats_.bytes > max_bytes_ && !lru_.empty()) {
+    Erase(std::prev(lru_.end()));
+    stats_.evictions++;
+  }
+}
+
+void FrameResultCache::AddCoalesced() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  stats_.coalesced++;
+}
+
+FrameResultCache::Stats FrameResultCache::GetStats() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Stats stats = stats_;
+  stats.entries = lru_.size();
+  return stats;
+}
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <mutex>
+
+#include "infer_backend_dispatcher.hpp"
+
+
+InferBackendDispatcher::InferBackendDispatcher(double device_service_ms, double cpu_service_ms) {
+  device_.service_ms = device_service_ms;
+  cpu_.service_ms = cpu_service_ms;
+}
+
+void InferBackendDispatcher::SetEnable(bool enable) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  enable_ = enable;
+}
+
+void InferBackendDispatcher::SetPathCosts(const PathCosts& costs) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  costs_ = costs;
+}
+
+/**
+ * @brief 为下一个批次选择推理后端, 并计入该后端的在途批次
+ */
+InferBackend InferBackendDispatcher::Dispatch() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  InferBackend backend = InferBackend::kDevice;
+  if (enable_ && cpu_.inflight < costs_.cpu_max_inflight) {
+    double device_finish_ms = costs_.h2d_ms + (device_.inflight + 1) * device_.service_ms + costs_.d2h_ms;
+    double drain_ms = 0;
+    if (device_.inflight > 0) {
+      uint32_t blocked = device_.inflight > costs_.device_input_depth ? device_.inflight - costs_.device_input_depth : 0;
+      drain_ms = blocked * device_.service_ms + costs_.h2d_ms;
+    }
+    double cpu_finish_ms = std::max(drain_ms, cpu_.inflight * cpu_.service_ms) + costs_.cpu_copy_ms + cpu_.service_ms;
+    if (device_finish_ms > cpu_finish_ms) backend = InferBackend::kCpu;
+  }
+  Counters& counters = CountersOf(backend);
+  counters.batches++;
+  counters.inflight++;
+  return backend;
+}
+
+/**
+ * @brief 推理阶段完成一个批次后上报, 更新在途数与服务时间估计
+ */
+void InferBackendDispatcher::BatchDone(InferBackend backend, double service_ms) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Counters& counters = CountersOf(backend);
+  if (counters.inflight > 0) counters.inflight--;
+  counters.done++;
+  counters.service_ms = (1 - kSmoothFactor) * counters.service_ms + kSmoothFactor * service_ms;
+}
+
+void InferBackendDispatcher::ResetServiceTimes(double device_service_ms, double cpu_service_ms) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  device_.service_ms = device_service_ms;
+  cpu_.service_ms = cpu_service_ms;
+}
+
+InferBackendDispatcher::Counters InferBackendDispatcher::GetCounters(InferBackend backend) const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return backend == InferBackend::kCpu ? cpu_ : device_;
+}
@@ -19,7 +19,9 @@
  *************************************************************************/
 
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <mutex>
@@ -27,24 +29,66 @@
 #include <stdexcept>
 #include <iostream>
 
+#include "cpu_affinity.hpp"
 #include "infer_thread_pool.hpp"
 
 
-void InferThreadPool::Init(size_t thread_num) {
+void InferThreadPool::Init(size_t thread_num, const std::vector<int>& cpus) {
   std::unique_lock<std::mutex> lk(mtx_);
   running_ = true;
+  cpus_ = cpus;
   max_tnum_ = 2 * thread_num;
+  min_thread_num_ = thread_num;
   for (size_t ti = 0; ti < thread_num; ++ti) {
-    threads_.push_back(std::thread(&InferThreadPool::TaskLoop, this));
+    SpawnWorker();
   }
 }
 
+void InferThreadPool::SetElastic(size_t max_thread_num, uint32_t idle_timeout_ms) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  elastic_ = true;
+  max_thread_num_ = max_thread_num;
+  idle_timeout_ms_ = idle_timeout_ms;
+}
+
+/**
+ * @brief 新建 worker, 需持有 mtx_
+ */
+void InferThreadPool::SpawnWorker() {
+  threads_.push_back(std::thread(&InferThreadPool::TaskLoop, this));
+  if (AliveThreadNum() > stats_.peak_thread_num) stats_.peak_thread_num = AliveThreadNum();
+  max_tnum_ = std::max(max_tnum_, 2 * AliveThreadNum());  // 队列容量随扩容增长
+}
+
+/**
+ * @brief 弹性扩容: 所有 worker 阻塞且有任务等待时新建 worker, 需持有 mtx_
+ */
+void InferThreadPool::TrySpawnWorker() {
+  if (!elastic_ || !running_ || task_q_.empty()) return;
+  if (blocked_num_ < AliveThreadNum() || AliveThreadNum() >= max_thread_num_) return;
+  JoinRetiredThreads();
+  SpawnWorker();
+  stats_.spawned++;
+}
+
+void InferThreadPool::OnWorkerBlocked() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  blocked_num_++;
+  TrySpawnWorker();
+}
+
+void InferThreadPool::OnWorkerUnblocked() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  blocked_num_--;
+}
+
 void InferThreadPool::Destroy() {
   std::unique_lock<std::mutex> lk(mtx_);
   running_ = false;
   lk.unlock();
   q_push_cond_.notify_all();
   q_pop_cond_.notify_all();
+  retired_cond_.notify_all();
 
   for (auto& it : threads_) {
     if (it.joinable()) it.join();
@@ -52,20 +96,89 @@ void InferThreadPool::Destroy() {
 
   lk.lock();
   threads_.clear();
+  retired_ids_.clear();
+  retire_num_ = 0;
+  blocked_num_ = 0;
   while (!task_q_.empty()) {
     task_q_.pop();
   }
 }
 
+/**
+ * @brief 调整 worker 数量, 队列容量随之调整
+ * 缩容时空闲 worker 优先退出, 忙碌的 worker 执行完当前任务后退出, 本函数等待其退出后返回
+ */
+void InferThreadPool::Resize(size_t thread_num) {
+  std::unique_lock<std::mutex> lk(mtx_);
+  if (!running_) return;
+  max_tnum_ = std::max(2 * thread_num, task_q_.size());
+  min_thread_num_ = thread_num;
+  JoinRetiredThreads();
+  while (threads_.size() < thread_num) {
+    SpawnWorker();
+  }
+  if (threads_.size() > thread_num) {
+    retire_num_ = threads_.size() - thread_num;
+    lk.unlock();
+    q_pop_cond_.notify_all();
+    lk.lock();
+    retired_cond_.wait(lk, [this]() -> bool { return 0 == retire_num_ || !running_; });
+    JoinRetiredThreads();
+  }
+  lk.unlock();
+  q_push_cond_.notify_all();
+}
+
+/**
+ * @brief 回收已退出的 worker, 需持有 mtx_
+ */
+void InferThreadPool::JoinRetiredThreads() {
+  for (const auto& id : retired_ids_) {
+    for (auto it = threads_.begin(); it != threads_.end(); ++it) {
+      if (it->get_id() == id) {
+        it->join();
+        threads_.erase(it);
+        break;
+      }
+    }
+  }
+  retired_ids_.clear();
+}
+
 void InferThreadPool::SubmitTask(const InferTaskSptr& task) {
   if (!task.get()) return;
   std::unique_lock<std::mutex> lk(mtx_);
 
-  q_push_cond_.wait(lk, [this]() -> bool { return task_q_.size() < max_tnum_ || !running_; });
-  assert(task_q_.size() < max_tnum_);  // when push_cond ready, task_q_ should not be max-size
+  if (task_q_.size() >= max_tnum_ && running_) {
+    auto start = std::chrono::steady_clock::now();
+    // worker 提交任务时阻塞 (如级联流水线在后处理中送入子帧), 与等待 ticket 一样计入阻塞数
+    WorkerBlockingObserver* observer = WorkerBlockingObserver::Current();
+    if (observer == this) {
+      blocked_num_++;
+      TrySpawnWorker();
+    } else if (observer) {
+      lk.unlock();
+      observer->OnWorkerBlocked();
+      lk.lock();
+    }
+    q_push_cond_.wait(lk, [this]() -> bool { return task_q_.size() < max_tnum_ || !running_; });
+    if (observer == this) {
+      blocked_num_--;
+    } else if (observer) {
+      lk.unlock();
+      observer->OnWorkerUnblocked();
+      lk.lock();
+    }
+    stats_.blocked_submits++;
+    stats_.blocked_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
 
   if (!running_) return;
+  assert(task_q_.size() < max_tnum_);  // when push_cond ready, task_q_ should not be max-size
   task_q_.push(task);
+  stats_.submitted++;
+  if (task_q_.size() > stats_.queue_hwm) stats_.queue_hwm = task_q_.size();
+  TrySpawnWorker();
 
   lk.unlock();
   q_pop_cond_.notify_one();
@@ -79,9 +192,29 @@ InferTaskSptr InferThreadPool::PopTask() {
   std::unique_lock<std::mutex> lk(mtx_);
   assert(task_q_.size() <= max_tnum_);
 
-  q_pop_cond_.wait(lk, [this]() -> bool { return task_q_.size() > 0 || !running_; });
+  auto ready = [this]() -> bool { return task_q_.size() > 0 || !running_ || retire_num_ > 0; };
+  if (elastic_) {
+    while (!q_pop_cond_.wait_for(lk, std::chrono::milliseconds(idle_timeout_ms_), ready)) {
+      if (AliveThreadNum() > min_thread_num_) {
+        // 空闲超时, 当前 worker 退出, 由后续扩容或 Resize 时回收
+        retired_ids_.push_back(std::this_thread::get_id());
+        stats_.retired++;
+        return nullptr;
+      }
+    }
+  } else {
+    q_pop_cond_.wait(lk, ready);
+  }
 
   if (!running_) return nullptr;
+  if (retire_num_ > 0) {
+    // 缩容, 当前 worker 退出
+    retire_num_--;
+    retired_ids_.push_back(std::this_thread::get_id());
+    lk.unlock();
+    retired_cond_.notify_all();
+    return nullptr;
+  }
 
   auto task = task_q_.front();
   task_q_.pop();
@@ -91,16 +224,28 @@ InferTaskSptr InferThreadPool::PopTask() {
   return task;
 }
 
+InferThreadPool::Stats InferThreadPool::GetStats() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Stats stats = stats_;
+  stats.queue_size = task_q_.size();
+  stats.queue_capacity = max_tnum_;
+  stats.thread_num = AliveThreadNum();
+  stats.blocked_num = blocked_num_;
+  return stats;
+}
+
 void InferThreadPool::SetErrorHandleFunc(const std::function<void(const std::string& err_msg)>& err_func) {
   std::lock_guard<std::mutex> lk(mtx_);
   error_func_ = err_func;
 }
 
 void InferThreadPool::TaskLoop() {
+  SetCurrentThreadAffinity(cpus_);
+  WorkerBlockingObserver::Current() = this;
   while (running_) {
     InferTaskSptr task = PopTask();
     if (task.get() == nullptr) {
-      assert(!running_);
+      // pool destroyed or worker retired
       return;
     }
     task->WaitForFrontTasksComplete();
@@ -31,6 +31,7 @@
 
 #include "infer_resource.hpp"
 #include "infer_trans_data_helper.hpp"
+#include "result_sink.hpp"
 
 
 
@@ -44,6 +45,7 @@ InferTransDataHelper::~InferTransDataHelper() {
   {
     cond_not_empty_.notify_all();
     cond_not_full_.notify_all();
+    cond_processed_.notify_all();
   }
   if (th_.joinable()) th_.join();
 }
@@ -65,13 +67,33 @@ void InferTransDataHelper::Loop() {
     if (!running_.load()) break;
     auto data = queue_.front();
     queue_.pop();
+    std::shared_ptr<ResultSink> sink = sink_;
     lk.unlock();
     cond_not_full_.notify_one();
 
     std::shared_ptr<FrameInfo> finfo = data.first;
     auto card = data.second;
-    card.WaitForCall();
+    FrameStatus status = card.WaitForCall();
 
-    std::cout << "Infer trans data helper: " << finfo->batch_index << "; item: " << finfo->item_index << std::endl;
+    std::cout << "Infer trans data helper: " << finfo->batch_index << "; item: " << finfo->item_index;
+    if (FrameStatus::kDropped == status) std::cout << "; dropped";
+    if (!finfo->children.empty()) std::cout << "; children: " << finfo->children.size();
+    std::cout << std::endl;
+    if (sink && FrameStatus::kOk == status) sink->Append(*finfo);
+
+    lk.lock();
+    processed_++;
+    lk.unlock();
+    cond_processed_.notify_all();
   }
 }
+
+void InferTransDataHelper::SetResultSink(std::shared_ptr<ResultSink> sink) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  sink_ = sink;
+}
+
+void InferTransDataHelper::WaitForProcessed(uint64_t count) {
+  std::unique_lock<std::mutex> lk(mtx_);
+  cond_processed_.wait(lk, [this, count]() { return !running_.load() || processed_ >= count; });
+}
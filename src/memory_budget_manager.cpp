@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "memory_budget_manager.hpp"
+
+
+/**
+ * @brief 默认分配粒度: host 按页 4KB, device 按 64KB
+ */
+MemoryBudgetManager::MemoryBudgetManager(size_t global_cap_bytes) : global_cap_bytes_(global_cap_bytes) {
+  pools_[static_cast<int>(MemoryPool::kHost)].alignment = 4096;
+  pools_[static_cast<int>(MemoryPool::kDevice)].alignment = 64 * 1024;
+}
+
+void MemoryBudgetManager::SetPoolCap(MemoryPool pool, size_t cap_bytes) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  pools_[static_cast<int>(pool)].cap_bytes = cap_bytes;
+}
+
+void MemoryBudgetManager::SetPoolAlignment(MemoryPool pool, size_t alignment) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  pools_[static_cast<int>(pool)].alignment = std::max<size_t>(1, alignment);
+}
+
+size_t MemoryBudgetManager::AlignUp(MemoryPool pool, size_t bytes) const {
+  size_t alignment = pools_[static_cast<int>(pool)].alignment;
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+bool MemoryBudgetManager::Fits(const size_t extra[kNumPools]) const {
+  size_t total = 0;
+  for (int i = 0; i < kNumPools; ++i) {
+    const PoolStats& pool = pools_[i];
+    size_t pool_bytes = pool.usage.reserved_bytes + planned_bytes_[i] + extra[i];
+    if (pool.cap_bytes > 0 && pool_bytes > pool.cap_bytes) return false;
+    total += planned_bytes_[i] + extra[i];
+  }
+  return 0 == global_cap_bytes_ || global_reserved_bytes_ + total <= global_cap_bytes_;
+}
+
+bool MemoryBudgetManager::Reserve(const std::string& name, MemoryPool pool, size_t bytes) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  PoolStats& stats = pools_[static_cast<int>(pool)];
+  size_t reserved = AlignUp(pool, bytes);
+  size_t extra[kNumPools] = { 0 };
+  extra[static_cast<int>(pool)] = reserved;
+  auto plan = planned_.find(name);
+  if (plan != planned_.end() && plan->second.pool == pool && plan->second.reserved_bytes == reserved) {
+    // 使用规划时已计入预算的额度
+    planned_bytes_[static_cast<int>(pool)] -= reserved;
+    if (0 == --plan->second.buffers) planned_.erase(plan);
+  } else if (!Fits(extra)) {
+    stats.rejections++;
+    std::cout << "Memory budget exceeded: " << name << " requests " << reserved << " B, "
+        << PoolName(pool) << " " << stats.usage.reserved_bytes << "/" << stats.cap_bytes << " B, total "
+        << global_reserved_bytes_ << "/" << global_cap_bytes_ << " B" << std::endl;
+    return false;
+  }
+  for (Usage* usage : { &stats.usage, &resources_[name] }) {
+    usage->requested_bytes += bytes;
+    usage->reserved_bytes += reserved;
+    usage->buffers++;
+  }
+  stats.peak_bytes = std::max(stats.peak_bytes, stats.usage.reserved_bytes);
+  global_reserved_bytes_ += reserved;
+  global_peak_bytes_ = std::max(global_peak_bytes_, global_reserved_bytes_);
+  return true;
+}
+
+void MemoryBudgetManager::Release(const std::string& name, MemoryPool pool, size_t bytes) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  size_t reserved = AlignUp(pool, bytes);
+  auto it = resources_.find(name);
+  for (Usage* usage : { &pools_[static_cast<int>(pool)].usage, it != resources_.end() ? &it->second : nullptr }) {
+    if (!usage) continue;
+    usage->requested_bytes -= bytes;
+    usage->reserved_bytes -= reserved;
+    usage->buffers--;
+  }
+  if (it != resources_.end() && 0 == it->second.buffers) resources_.erase(it);
+  global_reserved_bytes_ -= reserved;
+}
+
+std::vector<uint32_t> MemoryBudgetManager::PlanDepths(const std::vector<DepthRequest>& requests) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::vector<uint32_t> depths(requests.size(), 1);
+  size_t extra[kNumPools] = { 0 };
+  for (const auto& request : requests) extra[static_cast<int>(request.pool)] += AlignUp(request.pool, request.buffer_bytes);
+  if (!Fits(extra)) return {};
+
+  double bottleneck_ms = 0;
+  for (const auto& request : requests) {
+    bottleneck_ms = std::max({ bottleneck_ms, request.writer_ms, request.reader_ms });
+  }
+  auto adjacent_ms = [&requests](size_t i) { return std::max(requests[i].writer_ms, requests[i].reader_ms); };
+  std::vector<uint32_t> limits(requests.size(), 1);
+  uint32_t max_limit = 1;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    bool at_bottleneck = adjacent_ms(i) >= bottleneck_ms;
+    limits[i] = at_bottleneck ? requests[i].max_depth : std::min(2u, requests[i].max_depth);
+    max_limit = std::max(max_limit, limits[i]);
+  }
+  std::vector<size_t> order(requests.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    if (adjacent_ms(lhs) != adjacent_ms(rhs)) return adjacent_ms(lhs) > adjacent_ms(rhs);
+    return requests[lhs].buffer_bytes < requests[rhs].buffer_bytes;
+  });
+
+  for (uint32_t depth = 2; depth <= max_limit; ++depth) {
+    for (size_t i : order) {
+      if (depths[i] + 1 != depth || depth > limits[i]) continue;
+      const DepthRequest& request = requests[i];
+      extra[static_cast<int>(request.pool)] += AlignUp(request.pool, request.buffer_bytes);
+      if (Fits(extra)) {
+        depths[i] = depth;
+      } else {
+        extra[static_cast<int>(request.pool)] -= AlignUp(request.pool, request.buffer_bytes);
+      }
+    }
+  }
+  for (size_t i = 0; i < requests.size(); ++i) {
+    Plan& plan = planned_[requests[i].name];
+    plan.pool = requests[i].pool;
+    plan.reserved_bytes = AlignUp(requests[i].pool, requests[i].buffer_bytes);
+    plan.buffers += depths[i];
+  }
+  for (int i = 0; i < kNumPools; ++i) planned_bytes_[i] += extra[i];
+  return depths;
+}
+
+void MemoryBudgetManager::ReleasePlanned(const std::string& name_prefix) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  for (auto it = planned_.begin(); it != planned_.end();) {
+    if (0 == it->first.compare(0, name_prefix.size(), name_prefix)) {
+      planned_bytes_[static_cast<int>(it->second.pool)] -= it->second.reserved_bytes * it->second.buffers;
+      it = planned_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+MemoryBudgetManager::Stats MemoryBudgetManager::GetStats() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Stats stats;
+  stats.global_cap_bytes = global_cap_bytes_;
+  stats.reserved_bytes = global_reserved_bytes_;
+  stats.peak_bytes = global_peak_bytes_;
+  std::copy(pools_, pools_ + kNumPools, stats.pools);
+  stats.resources = resources_;
+  return stats;
+}
+
+const char* MemoryBudgetManager::PoolName(MemoryPool pool) {
+  return pool == MemoryPool::kDevice ? "device" : "host";
+}
@@ -0,0 +1,57 @@
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "pipeline_clock.hpp"
+
+
+std::shared_ptr<PipelineClock> PipelineClock::System() {
+  static std::shared_ptr<PipelineClock> clock = std::make_shared<SystemClock>();
+  return clock;
+}
+
+void SystemClock::SleepFor(std::chrono::milliseconds duration) {
+  std::this_thread::sleep_for(duration);
+}
+
+bool SystemClock::WaitUntil(std::condition_variable& cond, std::unique_lock<std::mutex>& lk, TimePoint deadline,
+                            const std::function<bool()>& pred) {
+  return cond.wait_until(lk, deadline, pred);
+}
+
+PipelineClock::TimePoint ManualClock::Now() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  return now_;
+}
+
+void ManualClock::SleepFor(std::chrono::milliseconds duration) {
+  std::unique_lock<std::mutex> lk(mtx_);
+  TimePoint deadline = now_ + duration;
+  if (auto_advance_) {
+    now_ = deadline;
+    lk.unlock();
+    cond_.notify_all();
+    return;
+  }
+  cond_.wait(lk, [this, deadline]() { return now_ >= deadline; });
+}
+
+bool ManualClock::WaitUntil(std::condition_variable& cond, std::unique_lock<std::mutex>& lk, TimePoint deadline,
+                            const std::function<bool()>& pred) {
+  while (!pred()) {
+    if (Now() >= deadline) return pred();
+    cond.wait_for(lk, std::chrono::milliseconds(kPollIntervalMs));
+  }
+  return true;
+}
+
+void ManualClock::Advance(std::chrono::milliseconds duration) {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    now_ += duration;
+  }
+  cond_.notify_all();
+}
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "memory_budget_manager.hpp"
+#include "pipeline_simulator.hpp"
+
+
+double SimServiceTime::Sample(uint32_t items, std::mt19937_64* rng) const {
+  double mean = base_ms + per_item_ms * items;
+  if (mean <= 0) return 0;
+  switch (dist) {
+    case Dist::kUniform: {
+      double lo = std::max(0.0, mean * (1 - spread));
+      double hi = mean * (1 + spread);
+      return std::uniform_real_distribution<double>(lo, hi)(*rng);
+    }
+    case Dist::kExponential:
+      return std::exponential_distribution<double>(1.0 / mean)(*rng);
+    default:
+      return mean;
+  }
+}
+
+void PipelineSimulator::PushEvent(Event::Type type, double time_ms, uint64_t arg, Worker* worker) {
+  Event event;
+  event.time_ms = time_ms;
+  event.seq = event_seq_++;
+  event.type = type;
+  event.arg = arg;
+  event.worker = worker;
+  events_.push(event);
+}
+
+/**
+ * @brief 与 InferPipeline::PlanBufferDepths 的请求相同, 在不设上限的预算内规划 mlu_input/mlu_output/cpu_output 的份数
+ */
+void PipelineSimulator::PlanDepths(uint32_t depths[3]) const {
+  std::fill(depths, depths + 3, 1u);
+  if (config_.max_buffer_depth <= 1) return;
+  uint32_t bs = config_.batchsize;
+  auto mean_ms = [bs](const SimServiceTime& service) { return service.base_ms + service.per_item_ms * bs; };
+  std::vector<MemoryBudgetManager::DepthRequest> requests = {
+    { "mlu_input", MemoryPool::kDevice, 1, mean_ms(config_.h2d), mean_ms(config_.infer), config_.max_buffer_depth },
+    { "mlu_output", MemoryPool::kDevice, 1, mean_ms(config_.infer), mean_ms(config_.d2h), config_.max_buffer_depth },
+    { "cpu_output", MemoryPool::kHost, 1, mean_ms(config_.d2h), mean_ms(config_.postprocessing),
+      config_.max_buffer_depth },
+    { "cpu_input", MemoryPool::kHost, 1, mean_ms(config_.preprocessing), mean_ms(config_.h2d), 1 },
+  };
+  std::vector<uint32_t> planned = MemoryBudgetManager().PlanDepths(requests);
+  std::copy(planned.begin(), planned.begin() + 3, depths);
+}
+
+void PipelineSimulator::AddWorker(int queue) {
+  auto worker = std::make_shared<Worker>();
+  worker->queue = queue;
+  workers_.push_back(worker);
+  queue_threads_[queue]++;
+}
+
+/**
+ * @brief 与 main 中的 GetThreadPool 相同: 未启用独立 worker 组时所有任务进入同一队列
+ */
+int PipelineSimulator::QueueIndex(WorkerGroup group) const {
+  return config_.dedicated_worker_groups ? static_cast<int>(group) : 0;
+}
+
+/**
+ * @brief 运行一次仿真, 每个 PipelineSimulator 只能调用一次
+ */
+SimResult PipelineSimulator::Run() {
+  rng_.seed(config_.seed);
+  uint32_t depths[3];
+  PlanDepths(depths);
+  Ring* rings[] = { &mlu_input_, &mlu_output_, &cpu_output_ };
+  for (int i = 0; i < 3; ++i) {
+    for (uint32_t j = 0; j < depths[i]; ++j) rings[i]->slots.push_back(std::make_shared<QueuingServer>());
+  }
+  if (config_.dedicated_worker_groups) {
+    for (size_t i = 0; i < config_.cpu_threads; ++i) AddWorker(QueueIndex(WorkerGroup::kCpuBound));
+    for (size_t i = 0; i < config_.device_threads; ++i) AddWorker(QueueIndex(WorkerGroup::kDeviceBound));
+  } else {
+    for (size_t i = 0; i < config_.shared_threads; ++i) AddWorker(0);
+  }
+  arrival_ms_.assign(arrival_.num_frames, 0);
+  done_ms_.assign(arrival_.num_frames, -1);
+  if (arrival_.num_frames > 0) PushEvent(Event::Type::kArrival, 0, 0);
+
+  while (!events_.empty()) {
+    Event event = events_.top();
+    events_.pop();
+    now_ms_ = event.time_ms;
+    switch (event.type) {
+      case Event::Type::kArrival: {
+        uint32_t frame_id = static_cast<uint32_t>(event.arg);
+        Feed(frame_id);
+        if (frame_id + 1 < arrival_.num_frames) {
+          double interval = 1000.0 / arrival_.fps;
+          if (arrival_.process == SimArrival::Process::kPoisson) {
+            interval = std::exponential_distribution<double>(arrival_.fps / 1000.0)(rng_);
+          }
+          PushEvent(Event::Type::kArrival, now_ms_ + interval, frame_id + 1);
+        }
+        break;
+      }
+      case Event::Type::kTimeout:
+        if (event.arg == pending_batch_seq_ && !pending_frames_.empty()) FlushBatch(true);
+        break;
+      case Event::Type::kComplete:
+        Complete(event.worker);
+        break;
+    }
+    Dispatch();
+  }
+
+  // 无事件可推进但仍有任务未完成: worker 全部阻塞在等待队列中任务的 ticket 上
+  for (const auto& worker : workers_) {
+    if (worker->task) result_.deadlock = true;
+  }
+  for (const auto& queue : queues_) {
+    if (!queue.empty()) result_.deadlock = true;
+  }
+
+  std::vector<double> latencies;
+  double last_done_ms = 0;
+  for (uint32_t i = 0; i < arrival_.num_frames; ++i) {
+    if (done_ms_[i] < 0) continue;
+    latencies.push_back(done_ms_[i] - arrival_ms_[i]);
+    last_done_ms = std::max(last_done_ms, done_ms_[i]);
+  }
+  result_.frames = static_cast<uint32_t>(latencies.size());
+  result_.duration_ms = last_done_ms;
+  if (!latencies.empty()) {
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+      return latencies[static_cast<size_t>(p * (latencies.size() - 1) + 0.5)];
+    };
+    result_.latency_mean_ms = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+    result_.latency_p50_ms = percentile(0.5);
+    result_.latency_p90_ms = percentile(0.9);
+    result_.latency_p99_ms = percentile(0.99);
+    result_.latency_max_ms = latencies.back();
+  }
+  if (result_.duration_ms > 0) {
+    result_.throughput_fps = result_.frames * 1000.0 / result_.duration_ms;
+    result_.infer_busy = infer_busy_ms_ / result_.duration_ms;
+  }
+  return result_;
+}
+
+/**
+ * @brief 与 ShapeBucketBatcher::Feed 及 IOBatchingStage::Batching 相同: 提交前处理任务, 攒满一批时刷出
+ */
+void PipelineSimulator::Feed(uint32_t frame_id) {
+  arrival_ms_[frame_id] = now_ms_;
+  bool reserve_ticket = (batch_idx_ + 1 != config_.batchsize);
+  auto task = std::make_shared<Task>();
+  task->group = WorkerGroup::kCpuBound;
+  task->waits.emplace_back(&cpu_input_, cpu_input_.PickUpTicket(reserve_ticket));
+  task->service = &config_.preprocessing;
+  Submit(task);
+  batch_idx_ = (batch_idx_ + 1) % config_.batchsize;
+
+  if (pending_frames_.empty()) {
+    PushEvent(Event::Type::kTimeout, now_ms_ + config_.bucket_max_wait_ms, pending_batch_seq_);
+  }
+  pending_frames_.push_back(frame_id);
+  if (pending_frames_.size() == config_.batchsize) FlushBatch(false);
+}
+
+/**
+ * @brief 按 InferPipeline::BatchingDone 中 device 路径的阶段顺序取票并提交任务
+ * 取票顺序抄自 H2D/Infer/D2H/PostprocessingBatchingDoneStage 在 transfer_chunk_items 为 0 时的行为,
+ * 各阶段取票方式变化时需同步修改; 分块传输与 CPU 路径不在此模拟, RunSimulation 对启用它们的配置不给出推荐.
+ */
+void PipelineSimulator::FlushBatch(bool timeout) {
+  QueuingServer* mlu_input = mlu_input_.Next();
+  QueuingServer* mlu_output = mlu_output_.Next();
+  QueuingServer* cpu_output = cpu_output_.Next();
+  uint32_t items = static_cast<uint32_t>(pending_frames_.size());
+  auto make_task = [items](WorkerGroup group, const SimServiceTime* service) {
+    auto task = std::make_shared<Task>();
+    task->group = group;
+    task->service = service;
+    task->items = items;
+    return task;
+  };
+
+  auto h2d = make_task(WorkerGroup::kDeviceBound, &config_.h2d);
+  h2d->waits.emplace_back(&cpu_input_, cpu_input_.PickUpNewTicket());
+  h2d->waits.emplace_back(mlu_input, mlu_input->PickUpNewTicket());
+  auto infer = make_task(WorkerGroup::kDeviceBound, &config_.infer);
+  infer->waits.emplace_back(mlu_input, mlu_input->PickUpNewTicket());
+  infer->waits.emplace_back(mlu_output, mlu_output->PickUpNewTicket());
+  infer->waits.emplace_back(&device_, device_.PickUpNewTicket());
+  auto d2h = make_task(WorkerGroup::kDeviceBound, &config_.d2h);
+  d2h->waits.emplace_back(mlu_output, mlu_output->PickUpNewTicket());
+  d2h->waits.emplace_back(cpu_output, cpu_output->PickUpNewTicket());
+  for (const auto& task : { h2d, infer, d2h }) Submit(task);
+  for (uint32_t bidx = 0; bidx < items; ++bidx) {
+    auto postproc = make_task(WorkerGroup::kCpuBound, &config_.postprocessing);
+    postproc->items = 1;
+    QueuingTicket ticket = (0 == bidx) ? cpu_output->PickUpNewTicket(true) : cpu_output->PickUpTicket(true);
+    postproc->waits.emplace_back(cpu_output, ticket);
+    postproc->frames.push_back(pending_frames_[bidx]);
+    Submit(postproc);
+  }
+
+  result_.batches++;
+  if (timeout) result_.timeout_flushes++;
+  batch_idx_ = 0;
+  pending_frames_.clear();
+  pending_batch_seq_++;
+}
+
+void PipelineSimulator::Submit(const std::shared_ptr<Task>& task) {
+  queues_[QueueIndex(task->group)].push_back(task);
+}
+
+/**
+ * @brief 空闲 worker 按 FIFO 取任务; 阻塞中的 worker 在其 ticket 全部就绪后开始服务
+ * 弹性线程池: 某队列的 worker 全部阻塞且仍有任务等待时新建 worker, 与 InferThreadPool::TrySpawnWorker 相同
+ */
+void PipelineSimulator::Dispatch() {
+  bool spawned = true;
+  while (spawned) {
+    size_t blocked[2] = { 0, 0 };
+    for (const auto& worker : workers_) {
+      auto& queue = queues_[worker->queue];
+      if (!worker->task && !queue.empty()) {
+        worker->task = queue.front();
+        queue.pop_front();
+      }
+      if (!worker->task || worker->serving) continue;
+      bool ready = std::all_of(worker->task->waits.begin(), worker->task->waits.end(),
+                               [](const std::pair<QueuingServer*, QueuingTicket>& wait) {
+                                 return wait.second.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                               });
+      if (!ready) {
+        blocked[worker->queue]++;
+        continue;
+      }
+      double service_ms = worker->task->service->Sample(worker->task->items, &rng_);
+      worker->serving = true;
+      if (worker->task->service == &config_.infer) infer_busy_ms_ += service_ms;
+      PushEvent(Event::Type::kComplete, now_ms_ + service_ms, 0, worker.get());
+    }
+    spawned = false;
+    for (int i = 0; i < 2; ++i) {
+      if (!queues_[i].empty() && blocked[i] == queue_threads_[i] && queue_threads_[i] < config_.max_threads) {
+        AddWorker(i);
+        spawned = true;
+      }
+    }
+  }
+}
+
+void PipelineSimulator::Complete(Worker* worker) {
+  std::shared_ptr<Task> task = worker->task;
+  worker->task.reset();
+  worker->serving = false;
+  for (const auto& wait : task->waits) wait.first->DeallingDone();
+  for (uint32_t frame_id : task->frames) done_ms_[frame_id] = now_ms_;
+}
+
+std::vector<PipelineSimulator::SweepEntry> PipelineSimulator::Sweep(const SimConfig& base, const SimArrival& arrival,
+                                                                    const SweepSpace& space, double max_p99_ms,
+                                                                    SweepEntry* best) {
+  std::vector<SweepEntry> entries;
+  const SweepEntry* best_entry = nullptr;
+  auto cost = [](const SimConfig& config) {
+    size_t threads = config.dedicated_worker_groups ? config.cpu_threads + config.device_threads : config.shared_threads;
+    return config.batchsize * config.max_buffer_depth + threads;
+  };
+  for (uint32_t batchsize : space.batchsizes) {
+    for (uint32_t depth : space.max_buffer_depths) {
+      for (uint32_t max_wait_ms : space.bucket_max_wait_ms) {
+        SweepEntry entry;
+        entry.config = base;
+        entry.config.batchsize = batchsize;
+        entry.config.max_buffer_depth = depth;
+        entry.config.bucket_max_wait_ms = max_wait_ms;
+        if (space.set_threads) space.set_threads(&entry.config);
+        entry.result = PipelineSimulator(entry.config, arrival).Run();
+        entries.push_back(entry);
+      }
+    }
+  }
+  for (const auto& entry : entries) {
+    if (entry.result.deadlock || entry.result.frames < arrival.num_frames) continue;
+    if (max_p99_ms > 0 && entry.result.latency_p99_ms > max_p99_ms) continue;
+    if (!best_entry || entry.result.throughput_fps > best_entry->result.throughput_fps * 1.01 ||
+        (entry.result.throughput_fps >= best_entry->result.throughput_fps * 0.99 &&
+         cost(entry.config) < cost(best_entry->config))) {
+      best_entry = &entry;
+    }
+  }
+  if (best && best_entry) *best = *best_entry;
+  return entries;
+}
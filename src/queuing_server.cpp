@@ -18,10 +18,13 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <atomic>
 #include <iostream>
 #include "queuing_server.hpp"
 
 
+static std::atomic<uint64_t> internal_error_count(0);
+
 /**
  * @brief 从队列中取出一个 ticket
  * @param reserve 是否保留当前 ticket, 保留后, 后续 PickUpTicket 会返回该 ticket
@@ -62,6 +65,7 @@ QueuingTicket QueuingServer::PickUpNewTicket(bool reserve) {
     if (0 == tickets_q_.back().reserved_time) {
       if (static_cast<int>(tickets_q_.size()) != 1) {
           std::cout << "Internel error" << std::endl;
+          internal_error_count++;
       }
       tickets_q_.pop();
     } else {
@@ -114,3 +118,13 @@ void QueuingServer::Call() {
   }
 }
 
+
+bool QueuingServer::Idle() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (tickets_q_.empty()) return true;
+  return 1 == tickets_q_.size() && reserved_ && 0 == tickets_q_.front().reserved_time;
+}
+
+uint64_t QueuingServer::InternalErrorCount() {
+  return internal_error_count.load();
+}
@@ -0,0 +1,50 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "frame_replay_source.hpp"
+#include "run_modes.hpp"
+
+
+bool RunReplay(const std::string& path, bool realtime, std::shared_ptr<InferPipeline> pipeline,
+               std::shared_ptr<InferTransDataHelper> trans_helper) {
+  FrameReplaySource source(path);
+  if (!source.Open()) return false;
+  uint64_t total_bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  size_t num_frames = source.Replay(pipeline->GetBatchsize(), realtime,
+                                    [&total_bytes, &pipeline, &trans_helper](std::shared_ptr<FrameInfo> finfo) {
+    total_bytes += finfo->payload->size();
+    ResultWaitingCard card = pipeline->FeedData(finfo);
+    trans_helper->SubmitData(std::make_pair(finfo, card));
+  });
+  pipeline->Flush();  // 末尾不满一个批次的帧
+  trans_helper->WaitForProcessed(num_frames);
+  double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (elapsed_s <= 0) elapsed_s = 1e-3;
+  std::cout << "Replay " << num_frames << " frames in " << elapsed_s << " s: "
+      << num_frames / elapsed_s << " fps, " << total_bytes / elapsed_s / (1 << 20) << " MB/s" << std::endl;
+  return true;
+}
+
+bool RunRecord(const std::string& path, const std::vector<FrameShape>& shapes, uint32_t num_frames,
+               int64_t frame_interval_us) {
+  std::vector<std::vector<uint8_t>> frames;
+  std::vector<int64_t> pts_us;
+  std::vector<FrameShape> frame_shapes;
+  uint64_t total_bytes = 0;
+  for (uint32_t fidx = 0; fidx < num_frames; ++fidx) {
+    FrameShape shape = shapes[fidx % shapes.size()];
+    frames.emplace_back(shape.Bytes(), static_cast<uint8_t>(fidx));
+    pts_us.push_back(fidx * frame_interval_us);
+    frame_shapes.push_back(shape);
+    total_bytes += shape.Bytes();
+  }
+  if (!FrameReplaySource::Record(path, frames, pts_us, frame_shapes)) return false;
+  std::cout << "Recorded " << num_frames << " frames (" << total_bytes << " B) to " << path << std::endl;
+  return true;
+}
@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "result_sink.hpp"
+
+
+struct ResultSink::IoUring {
+#ifdef HAVE_LIBURING
+  struct io_uring ring;
+  bool inited = false;
+  ~IoUring() {
+    if (inited) io_uring_queue_exit(&ring);
+  }
+#endif
+};
+
+namespace {
+
+double SecondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PutBytes(std::vector<uint8_t>* out, const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  out->insert(out->end(), bytes, bytes + size);
+}
+
+template <typename T>
+void Put(std::vector<uint8_t>* out, T value) {
+  PutBytes(out, &value, sizeof(value));
+}
+
+template <typename T>
+bool Get(const uint8_t** p, const uint8_t* end, T* value) {
+  if (static_cast<size_t>(end - *p) < sizeof(T)) return false;
+  std::memcpy(value, *p, sizeof(T));
+  *p += sizeof(T);
+  return true;
+}
+
+bool GetBytes(const uint8_t** p, const uint8_t* end, std::vector<uint8_t>* value) {
+  uint32_t size = 0;
+  if (!Get(p, end, &size) || static_cast<size_t>(end - *p) < size) return false;
+  value->assign(*p, *p + size);
+  *p += size;
+  return true;
+}
+
+}  // namespace
+
+ResultSink::ResultSink(const std::string& path, size_t buffer_bytes, uint32_t num_buffers)
+    : path_(path),
+      buffer_bytes_((std::max<size_t>(1, buffer_bytes) + kAlignment - 1) / kAlignment * kAlignment),
+      num_buffers_(std::max(1u, num_buffers)) {}
+
+ResultSink::~ResultSink() {
+  Close();
+}
+
+bool ResultSink::Open() {
+  Close();
+  fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    std::cout << "Open result sink failed: " << path_ << std::endl;
+    return false;
+  }
+#ifdef HAVE_LIBURING
+  uring_.reset(new IoUring());
+  uring_->inited = io_uring_queue_init(num_buffers_, &uring_->ring, 0) == 0;
+  if (!uring_->inited) {
+    std::cout << "io_uring unavailable, result sink falls back to pwrite" << std::endl;
+    uring_.reset();
+  }
+#endif
+  buffers_.assign(num_buffers_, Buffer());
+  for (auto& buf : buffers_) {
+    buf.data = static_cast<uint8_t*>(std::aligned_alloc(kAlignment, buffer_bytes_));
+    if (!buf.data) {
+      std::cout << "Allocate result sink buffers failed: " << num_buffers_ << " x " << buffer_bytes_ << " B"
+          << std::endl;
+      for (auto& allocated : buffers_) std::free(allocated.data);
+      buffers_.clear();
+      free_q_.clear();
+      close(fd_);
+      fd_ = -1;
+      uring_.reset();
+      return false;
+    }
+    free_q_.push_back(&buf);
+  }
+  next_offset_ = 0;
+  stats_ = Stats();
+  open_time_ = std::chrono::steady_clock::now();
+  stopping_ = false;
+  opened_ = true;
+  writer_ = std::thread(&ResultSink::WriteLoop, this);
+
+  std::vector<uint8_t> header;
+  Put(&header, kMagic);
+  Put(&header, kVersion);
+  std::unique_lock<std::mutex> lk(mtx_);
+  AppendBytes(&lk, header.data(), header.size());
+  return true;
+}
+
+void ResultSink::Append(const FrameInfo& finfo) {
+  std::unique_lock<std::mutex> lk(mtx_);
+  if (!opened_) return;
+  record_.clear();
+  Put<uint32_t>(&record_, 0);  // record_bytes, 序列化后回填
+  Put(&record_, finfo.batch_index);
+  Put(&record_, finfo.item_index);
+  Put(&record_, finfo.pts_us);
+  Put(&record_, static_cast<uint32_t>(finfo.result.size()));
+  PutBytes(&record_, finfo.result.data(), finfo.result.size());
+  Put(&record_, static_cast<uint32_t>(finfo.children.size()));
+  for (const auto& child : finfo.children) {
+    Put(&record_, static_cast<uint32_t>(child->result.size()));
+    PutBytes(&record_, child->result.data(), child->result.size());
+  }
+  uint32_t record_bytes = static_cast<uint32_t>(record_.size() - sizeof(uint32_t));
+  std::memcpy(record_.data(), &record_bytes, sizeof(record_bytes));
+  AppendBytes(&lk, record_.data(), record_.size());
+  stats_.records++;
+}
+
+/**
+ * @brief 拷贝到当前缓冲, 写满即提交; 没有空闲缓冲时在 lk 上等待写线程归还
+ */
+void ResultSink::AppendBytes(std::unique_lock<std::mutex>* lk, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    if (!current_) {
+      if (free_q_.empty()) {
+        stats_.stalls++;
+        free_cond_.wait(*lk, [this]() { return !free_q_.empty(); });
+      }
+      current_ = free_q_.front();
+      free_q_.pop_front();
+    }
+    size_t copy = std::min(size, buffer_bytes_ - current_->size);
+    std::memcpy(current_->data + current_->size, data, copy);
+    current_->size += copy;
+    data += copy;
+    size -= copy;
+    if (current_->size == buffer_bytes_) SubmitCurrent();
+  }
+}
+
+void ResultSink::SubmitCurrent() {
+  current_->offset = next_offset_;
+  next_offset_ += current_->size;
+  full_q_.push_back(current_);
+  current_ = nullptr;
+  full_cond_.notify_one();
+}
+
+void ResultSink::Flush() {
+  std::unique_lock<std::mutex> lk(mtx_);
+  if (!opened_) return;
+  if (current_ && current_->size > 0) SubmitCurrent();
+  free_cond_.wait(lk, [this]() { return free_q_.size() + (current_ ? 1 : 0) == num_buffers_; });
+}
+
+void ResultSink::Close() {
+  Flush();
+  std::unique_lock<std::mutex> lk(mtx_);
+  if (!opened_) return;
+  stopping_ = true;
+  lk.unlock();
+  full_cond_.notify_all();
+  writer_.join();
+
+  auto start = std::chrono::steady_clock::now();
+  bool synced = fdatasync(fd_) == 0;
+  double sync_s = SecondsSince(start);
+  if (!synced) std::cout << "Result sink sync failed: " << path_ << std::endl;
+  close(fd_);
+  fd_ = -1;
+  uring_.reset();
+  lk.lock();
+  stats_.io_s += sync_s;
+  if (!synced) stats_.write_errors++;
+  for (auto& buf : buffers_) std::free(buf.data);
+  buffers_.clear();
+  free_q_.clear();
+  current_ = nullptr;
+  stats_.elapsed_s = SecondsSince(open_time_);
+  opened_ = false;
+}
+
+ResultSink::Stats ResultSink::GetStats() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Stats stats = stats_;
+  if (opened_) stats.elapsed_s = SecondsSince(open_time_);
+  return stats;
+}
+
+/**
+ * @brief 写线程: pwrite 时逐块同步写; io_uring 时提交全部待写块, 无新块时等待至少一个完成
+ * 各块写入不同的文件偏移, 完成顺序不影响文件内容.
+ */
+void ResultSink::WriteLoop() {
+  uint32_t inflight = 0;
+  std::unique_lock<std::mutex> lk(mtx_);
+  while (true) {
+    full_cond_.wait(lk, [this, &inflight]() { return !full_q_.empty() || stopping_ || inflight > 0; });
+    if (full_q_.empty() && stopping_ && 0 == inflight) break;
+    std::deque<Buffer*> pending;
+    pending.swap(full_q_);
+    lk.unlock();
+
+    if (!uring_) {
+      for (Buffer* buf : pending) WriteSync(buf, 0);
+      lk.lock();
+      continue;
+    }
+#ifdef HAVE_LIBURING
+    auto start = std::chrono::steady_clock::now();
+    for (Buffer* buf : pending) {
+      struct io_uring_sqe* sqe = io_uring_get_sqe(&uring_->ring);
+      io_uring_prep_write(sqe, fd_, buf->data, buf->size, buf->offset);
+      io_uring_sqe_set_data(sqe, buf);
+      inflight++;
+    }
+    if (!pending.empty()) io_uring_submit(&uring_->ring);
+    struct io_uring_cqe* cqe = nullptr;
+    // 有新块时只收取已完成的, 否则阻塞等待一个完成
+    int ret = pending.empty() ? io_uring_wait_cqe(&uring_->ring, &cqe) : io_uring_peek_cqe(&uring_->ring, &cqe);
+    while (0 == ret && cqe) {
+      Buffer* buf = static_cast<Buffer*>(io_uring_cqe_get_data(cqe));
+      int res = cqe->res;
+      io_uring_cqe_seen(&uring_->ring, cqe);
+      inflight--;
+      double io_s = SecondsSince(start);
+      if (res < 0) {
+        std::cout << "Result sink write failed: " << path_ << ", " << std::strerror(-res) << std::endl;
+        WriteDone(buf, 0, io_s);
+      } else if (static_cast<size_t>(res) < buf->size) {
+        WriteSync(buf, static_cast<size_t>(res));  // 写入不完整, 剩余部分同步补写
+      } else {
+        WriteDone(buf, buf->size, io_s);
+      }
+      start = std::chrono::steady_clock::now();
+      cqe = nullptr;
+      ret = io_uring_peek_cqe(&uring_->ring, &cqe);
+    }
+#endif
+    lk.lock();
+  }
+}
+
+void ResultSink::WriteSync(Buffer* buf, size_t done) {
+  auto start = std::chrono::steady_clock::now();
+  size_t written = done;
+  while (written < buf->size) {
+    ssize_t ret = pwrite(fd_, buf->data + written, buf->size - written, buf->offset + written);
+    if (ret < 0 && EINTR == errno) continue;
+    if (ret <= 0) {
+      std::cout << "Result sink write failed: " << path_ << ", " << std::strerror(errno) << std::endl;
+      break;
+    }
+    written += static_cast<size_t>(ret);
+  }
+  WriteDone(buf, written, SecondsSince(start));
+}
+
+void ResultSink::WriteDone(Buffer* buf, size_t written, double io_s) {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    stats_.bytes += written;
+    stats_.buffers++;
+    stats_.io_s += io_s;
+    if (written < buf->size) stats_.write_errors++;
+    buf->size = 0;
+    free_q_.push_back(buf);
+  }
+  free_cond_.notify_all();
+}
+
+
+bool ResultSinkReader::Open() {
+  Close();
+  fd_ = open(path_.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    std::cout << "Open result file failed: " << path_ << std::endl;
+    return false;
+  }
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  if (!Fill(2 * sizeof(uint32_t))) {
+    std::cout << "Result file too short: " << path_ << std::endl;
+    Close();
+    return false;
+  }
+  const uint8_t* p = buf_.data() + begin_;
+  const uint8_t* end = buf_.data() + end_;
+  Get(&p, end, &magic);
+  Get(&p, end, &version);
+  if (magic != ResultSink::kMagic || version != ResultSink::kVersion) {
+    std::cout << "Not a result file: " << path_ << std::endl;
+    Close();
+    return false;
+  }
+  begin_ += 2 * sizeof(uint32_t);
+  return true;
+}
+
+void ResultSinkReader::Close() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  begin_ = end_ = 0;
+  corrupted_ = false;
+}
+
+bool ResultSinkReader::Fill(size_t size) {
+  if (end_ - begin_ >= size) return true;
+  if (fd_ < 0) return false;
+  std::memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+  end_ -= begin_;
+  begin_ = 0;
+  if (buf_.size() < size) buf_.resize(size);
+  while (end_ < size) {
+    ssize_t ret = read(fd_, buf_.data() + end_, buf_.size() - end_);
+    if (ret < 0 && EINTR == errno) continue;
+    if (ret <= 0) return false;
+    end_ += static_cast<size_t>(ret);
+  }
+  return true;
+}
+
+bool ResultSinkReader::Next(Record* record) {
+  if (!Fill(sizeof(uint32_t))) {
+    corrupted_ = end_ != begin_;  // 文件末尾残留不足一个长度前缀
+    return false;
+  }
+  uint32_t record_bytes = 0;
+  std::memcpy(&record_bytes, buf_.data() + begin_, sizeof(record_bytes));
+  if (record_bytes > kMaxRecordBytes || !Fill(sizeof(uint32_t) + record_bytes)) {
+    corrupted_ = true;
+    return false;
+  }
+  const uint8_t* p = buf_.data() + begin_ + sizeof(uint32_t);
+  const uint8_t* end = p + record_bytes;
+  uint32_t num_children = 0;
+  bool ok = Get(&p, end, &record->batch_index) && Get(&p, end, &record->item_index) &&
+            Get(&p, end, &record->pts_us) && GetBytes(&p, end, &record->result) && Get(&p, end, &num_children);
+  // 每个子帧至少有一个长度前缀, 子帧数超出记录剩余字节时视为损坏, 不按损坏的计数分配
+  ok = ok && num_children <= static_cast<size_t>(end - p) / sizeof(uint32_t);
+  record->children.resize(ok ? num_children : 0);
+  for (uint32_t i = 0; ok && i < num_children; ++i) ok = GetBytes(&p, end, &record->children[i]);
+  if (!ok || p != end) {
+    corrupted_ = true;
+    return false;
+  }
+  begin_ += sizeof(uint32_t) + record_bytes;
+  return true;
+}
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shape_bucket_batcher.hpp"
+
+
+void ShapeBucketBatcher::SetFuncs(const SubmitFunc& submit_func, const FlushFunc& flush_func) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  submit_func_ = submit_func;
+  flush_func_ = flush_func;
+}
+
+void ShapeBucketBatcher::AddBucket(const FrameShape& shape) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (!GetBucket(shape)) CreateBucket(shape);
+}
+
+void ShapeBucketBatcher::RefuseShape(const FrameShape& shape) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::cout << "Frame shape " << shape.width << "x" << shape.height
+      << " does not fit in memory budget, frames dropped" << std::endl;
+  rejected_shapes_.insert(shape);
+}
+
+void ShapeBucketBatcher::Start() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (running_) return;
+  running_ = true;
+  timeout_th_ = std::thread(&ShapeBucketBatcher::TimeoutLoop, this);
+}
+
+void ShapeBucketBatcher::Stop() {
+  std::unique_lock<std::mutex> lk(mtx_);
+  running_ = false;
+  lk.unlock();
+  stop_cond_.notify_all();
+  if (timeout_th_.joinable()) timeout_th_.join();
+}
+
+ShapeBucketBatcher::Bucket* ShapeBucketBatcher::GetBucket(const FrameShape& shape) {
+  auto it = buckets_.find(shape);
+  return it == buckets_.end() ? nullptr : it->second.get();
+}
+
+/**
+ * @brief 建桶并分配桶缓冲, 需持有 mtx_; 失败时记入 rejected_shapes_
+ */
+ShapeBucketBatcher::Bucket* ShapeBucketBatcher::CreateBucket(const FrameShape& shape) {
+  if (shape.Bytes() > mlu_input_ring_->GetItemBytes()) {
+    std::cout << "Frame shape " << shape.width << "x" << shape.height
+        << " exceeds device input buffer, frames dropped" << std::endl;
+    rejected_shapes_.insert(shape);
+    return nullptr;
+  }
+  if (budget_ && running_) {
+    // 预算只为预分配的尺寸规划, 运行中再建桶会占用其他缓冲与流水线的额度
+    std::cout << "Frame shape " << shape.width << "x" << shape.height
+        << " not planned in memory budget, frames dropped" << std::endl;
+    rejected_shapes_.insert(shape);
+    return nullptr;
+  }
+  std::unique_ptr<Bucket> bucket(new Bucket());
+  bucket->shape = shape;
+  bucket->cpu_input_res = std::make_shared<IOResource>(batchsize_, shape.Bytes());
+  bucket->cpu_input_res->SetNumaNode(numa_node_);
+  if (budget_) {
+    bucket->cpu_input_res->SetMemoryBudget(budget_, MemoryPool::kHost, budget_name_prefix_ + BucketBufferName(shape));
+  }
+  bucket->cpu_input_res->Init();
+  if (!bucket->cpu_input_res->Allocated()) {
+    std::cout << "Frame shape " << shape.width << "x" << shape.height
+        << " input buffer exceeds memory budget, frames dropped" << std::endl;
+    rejected_shapes_.insert(shape);
+    return nullptr;
+  }
+  bucket->batching_stage = std::make_shared<IOBatchingStage>(batchsize_, bucket->cpu_input_res);
+  bucket->h2d_stage = std::make_shared<H2DBatchingDoneStage>(batchsize_, bucket->cpu_input_res, mlu_input_ring_);
+  if (cpu_infer_input_res_ && cpu_infer_output_ring_) {
+    bucket->cpu_infer_stage = std::make_shared<CpuInferBatchingDoneStage>(batchsize_, bucket->cpu_input_res,
+                                                                          cpu_infer_input_res_,
+                                                                          cpu_infer_output_ring_, dispatcher_);
+  }
+  bucket->batching_stage->SetClock(clock_);
+  bucket->batching_stage->SetVerbose(verbose_);
+  for (auto& stage : { bucket->h2d_stage, bucket->cpu_infer_stage }) {
+    if (!stage) continue;
+    stage->SetClock(clock_);
+    stage->SetVerbose(verbose_);
+    stage->SetTraceFunc(trace_func_);
+  }
+  bucket->stats.shape = shape;
+  bucket->stats.buffer_num = 1;
+  bucket->stats.buffer_bytes = batchsize_ * shape.Bytes();
+  Bucket* ret = bucket.get();
+  buckets_[shape] = std::move(bucket);
+  return ret;
+}
+
+bool ShapeBucketBatcher::Feed(std::shared_ptr<FrameInfo> finfo, std::shared_ptr<AutoSetDone> auto_set_done) {
+  std::unique_lock<std::mutex> lk(mtx_);
+  Bucket* bucket = GetBucket(finfo->shape);
+  if (!bucket && !rejected_shapes_.count(finfo->shape)) bucket = CreateBucket(finfo->shape);
+  if (!bucket) {
+    // 丢弃该帧, auto_set_done 释放后结果卡立即返回 kDropped
+    auto_set_done->status = FrameStatus::kDropped;
+    return false;
+  }
+
+  InferTaskSptr task = bucket->batching_stage->Batching(finfo);
+  submit_q_.push_back({ { WorkerGroup::kCpuBound, { task } } });
+  queued_num_++;
+
+  if (bucket->finfos.empty()) bucket->first_arrival = clock_->Now();
+  bucket->finfos.push_back(std::make_pair(finfo, auto_set_done));
+  bucket->stats.frames++;
+  if (bucket->finfos.size() == batchsize_) Flush(bucket, false);
+  SubmitPending(lk);
+  return true;
+}
+
+void ShapeBucketBatcher::FlushAll() {
+  std::unique_lock<std::mutex> lk(mtx_);
+  for (auto& it : buckets_) Flush(it.second.get(), false);
+  SubmitPending(lk);
+}
+
+std::vector<std::shared_ptr<IOResource>> ShapeBucketBatcher::GetResources() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::vector<std::shared_ptr<IOResource>> resources;
+  for (auto& it : buckets_) resources.push_back(it.second->cpu_input_res);
+  return resources;
+}
+
+std::vector<ShapeBucketBatcher::BucketStats> ShapeBucketBatcher::GetStats() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::vector<BucketStats> stats;
+  for (auto& it : buckets_) stats.push_back(it.second->stats);
+  return stats;
+}
+
+/**
+ * @brief 刷出桶内已有的帧, 需持有 mtx_; 后续阶段的任务进入 submit_q_, 由调用方 SubmitPending
+ */
+void ShapeBucketBatcher::Flush(Bucket* bucket, bool timeout) {
+  if (bucket->finfos.empty()) return;
+  size_t num = bucket->finfos.size();
+  bucket->stats.batches++;
+  if (timeout) bucket->stats.timeout_flushes++;
+  bucket->stats.padded_slots += batchsize_ - num;
+  bucket->stats.padding_bytes += batchsize_ * mlu_input_ring_->GetItemBytes() - num * bucket->shape.Bytes();
+
+  bucket->batching_stage->Reset();
+  if (flush_func_) {
+    submit_q_.push_back(flush_func_(bucket, bucket->finfos));
+    queued_num_++;
+  }
+  bucket->finfos.clear();
+}
+
+/**
+ * @brief 按取票顺序提交 submit_q_ 中的任务, 返回时调用方此前入队的任务均已提交; 需持有 mtx_
+ * 同一时刻只有一个线程在 mtx_ 外提交, 其他线程的任务由它一并提交, 等待期间释放 mtx_.
+ * 任务进入线程池的顺序因此与取票顺序一致, worker 不会先取到排在后面的 ticket 而占满线程池.
+ */
+void ShapeBucketBatcher::SubmitPending(std::unique_lock<std::mutex>& lk) {
+  const uint64_t target = queued_num_;
+  while (submitted_num_ < target) {
+    if (submitting_) {
+      submit_cond_.wait(lk);
+      continue;
+    }
+    submitting_ = true;
+    while (!submit_q_.empty()) {
+      StageTasks tasks = std::move(submit_q_.front());
+      submit_q_.pop_front();
+      lk.unlock();
+      if (submit_func_) {
+        for (const auto& it : tasks) submit_func_(it.first, it.second);
+      }
+      lk.lock();
+      submitted_num_++;
+    }
+    submitting_ = false;
+    submit_cond_.notify_all();
+  }
+}
+
+/**
+ * @brief 睡到最早到期的桶的截止时刻, 到期的桶恰在 first_arrival + max_wait 刷出;
+ * 各桶为空时睡一个超时周期, 期间到达的帧不会早于醒来时刻到期
+ */
+void ShapeBucketBatcher::TimeoutLoop() {
+  const auto max_wait = std::chrono::milliseconds(max_wait_ms_);
+  const auto idle_wait = std::max(max_wait, std::chrono::milliseconds(1));
+  std::unique_lock<std::mutex> lk(mtx_);
+  while (running_) {
+    auto deadline = clock_->Now() + idle_wait;
+    for (auto& it : buckets_) {
+      if (!it.second->finfos.empty()) deadline = std::min(deadline, it.second->first_arrival + max_wait);
+    }
+    clock_->WaitUntil(stop_cond_, lk, deadline, [this]() { return !running_; });
+    if (!running_) break;
+    auto now = clock_->Now();
+    for (auto& it : buckets_) {
+      Bucket* bucket = it.second.get();
+      if (!bucket->finfos.empty() && now - bucket->first_arrival >= max_wait) Flush(bucket, true);
+    }
+    SubmitPending(lk);
+  }
+}
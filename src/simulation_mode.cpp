@@ -0,0 +1,72 @@
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "pipeline_simulator.hpp"
+#include "run_modes.hpp"
+
+
+namespace {
+
+void PrintSimResult(const SimConfig& config, const SimResult& result) {
+  std::cout << "batchsize " << config.batchsize << ", max buffers " << config.max_buffer_depth << ", threads ";
+  if (config.dedicated_worker_groups) {
+    std::cout << config.cpu_threads << "/" << config.device_threads;
+  } else {
+    std::cout << config.shared_threads;
+  }
+  if (config.max_threads > 0) std::cout << " (elastic <= " << config.max_threads << ")";
+  std::cout << ", max wait " << config.bucket_max_wait_ms << " ms: ";
+  if (result.deadlock) {
+    std::cout << "deadlock after " << result.frames << " frames" << std::endl;
+    return;
+  }
+  std::cout << result.throughput_fps << " fps, latency mean " << result.latency_mean_ms
+      << " ms, p50 " << result.latency_p50_ms << " ms, p90 " << result.latency_p90_ms
+      << " ms, p99 " << result.latency_p99_ms << " ms, max " << result.latency_max_ms
+      << " ms, infer busy " << result.infer_busy << ", timeout flushes " << result.timeout_flushes << std::endl;
+}
+
+}  // namespace
+
+void RunSimulation(double fps, const SimConfig& current, const std::function<void(SimConfig* config)>& set_threads,
+                   const std::vector<std::string>& unmodelled_options) {
+  SimArrival arrival;
+  arrival.process = SimArrival::Process::kPoisson;
+  arrival.fps = fps;
+  arrival.num_frames = 2000;
+
+  SimConfig config = current;
+  if (set_threads) set_threads(&config);
+  config.infer.dist = SimServiceTime::Dist::kUniform;
+  config.infer.spread = 0.1;
+  std::cout << "Simulator models the device path (preprocessing - H2D - infer - D2H - postprocessing) with whole-batch"
+      << " transfers and a single frame shape; CPU fallback, chunked transfers, shape buckets, result dedup and"
+      << " cascades are not modelled" << std::endl;
+  std::cout << "Simulate " << arrival.num_frames << " frames at " << fps << " fps, current config:" << std::endl;
+  PrintSimResult(config, PipelineSimulator(config, arrival).Run());
+
+  PipelineSimulator::SweepSpace space;
+  space.batchsizes = { 1, 2, 4, 8, 16 };
+  space.max_buffer_depths = { 1 };
+  if (config.max_buffer_depth > 1) space.max_buffer_depths.push_back(config.max_buffer_depth);
+  space.bucket_max_wait_ms = { 50, 200, 1000, 3000 };
+  space.set_threads = set_threads;
+  PipelineSimulator::SweepEntry best;
+  double max_p99_ms = 5000;
+  auto entries = PipelineSimulator::Sweep(config, arrival, space, max_p99_ms, &best);
+  std::cout << "Sweep:" << std::endl;
+  for (const auto& entry : entries) PrintSimResult(entry.config, entry.result);
+  if (!unmodelled_options.empty()) {
+    // 结果只描述不带这些选项的 device 路径, 不能据此为实际配置给出推荐
+    std::cout << "No config recommended, not modelled:";
+    for (const auto& option : unmodelled_options) std::cout << " " << option;
+    std::cout << std::endl;
+  } else if (0 == best.result.frames) {
+    std::cout << "No config meets p99 latency " << max_p99_ms << " ms" << std::endl;
+  } else {
+    std::cout << "Recommended (p99 <= " << max_p99_ms << " ms): ";
+    PrintSimResult(best.config, best.result);
+  }
+}
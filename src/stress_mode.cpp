@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pipeline_clock.hpp"
+#include "queuing_server.hpp"
+#include "run_modes.hpp"
+
+
+bool RunStress(InferPipelineConfig config, uint32_t num_batches,
+               const InferPipeline::ThreadPoolGetter& get_thread_pool, uint32_t max_reconfigure_pause_ms,
+               std::shared_ptr<FrameBufferPool> buffer_pool, std::shared_ptr<InferPipeline>* pipeline) {
+  const uint32_t kStallTimeoutS = 120;
+  std::mutex trace_mtx;
+  std::unordered_map<const FrameInfo*, uint32_t> batch_of;  // 帧 -> 批次刷出序号
+  std::map<std::string, uint32_t> last_batch;               // 阶段 -> 最近处理的批次序号
+  std::vector<uint32_t> postproc_count;
+  std::vector<int> frame_stage;                             // 帧 -> 已完成的最后一个阶段
+  uint64_t order_violations = 0;
+  // 阶段 -> (前一阶段, 本阶段), device 路径 H2D-Infer-D2H-Postprocessing, CPU 路径 CpuInfer-CpuPostprocessing
+  const std::map<std::string, std::pair<int, int>> stage_order = {
+    { "H2D", { 0, 1 } }, { "Infer", { 1, 2 } }, { "D2H", { 2, 3 } }, { "CpuInfer", { 0, 3 } },
+    { "Postprocessing", { 3, 4 } }, { "CpuPostprocessing", { 3, 4 } } };
+  // 启用内存预算时缓冲可能多于一份, 相邻批次在不同缓冲上可以乱序完成, 批次顺序只校验在 device 上串行的推理阶段
+  const bool multi_buffered = nullptr != config.memory_budget;
+
+  auto clock = std::make_shared<ManualClock>(true);
+  config.clock = clock;
+  config.frame_shapes = { { 64, 48 }, { 128, 96 } };
+  config.bucket_max_wait_ms = 3600 * 1000;
+  config.enable_cpu_fallback = true;
+  config.cpu_service_ms = 1;  // 低估 CPU 耗时, 使实测值收敛前的批次同时走两个后端
+  config.result_cache_bytes = 0;
+  config.verbose = false;  // 关闭各阶段的逐帧打印
+  config.stage_trace_func = [&](const std::string& stage, const FrameInfo& finfo) {
+    std::lock_guard<std::mutex> lk(trace_mtx);
+    uint32_t batch = batch_of[&finfo];
+    auto it = last_batch.find(stage);
+    if ((!multi_buffered || stage == "Infer") && it != last_batch.end() && batch < it->second) order_violations++;
+    last_batch[stage] = batch;
+    const auto& order = stage_order.at(stage);
+    if (frame_stage[finfo.item_index] != order.first) order_violations++;
+    frame_stage[finfo.item_index] = order.second;
+    if (order.second == 4) postproc_count[finfo.item_index]++;
+  };
+  auto infer_pipeline = std::make_shared<InferPipeline>(config, get_thread_pool);
+  *pipeline = infer_pipeline;
+  if (!infer_pipeline->Init()) return false;
+
+  // 与 ShapeBucketBatcher 的桶顺序一致, 刷出时按尺寸从小到大
+  std::map<FrameShape, std::vector<const FrameInfo*>> pending;
+  uint32_t flush_seq = 0;
+  auto assign_batch = [&](std::vector<const FrameInfo*>* frames) {
+    std::lock_guard<std::mutex> lk(trace_mtx);
+    for (const FrameInfo* finfo : *frames) batch_of[finfo] = flush_seq;
+    frames->clear();
+    flush_seq++;
+  };
+  auto assign_all = [&]() {
+    for (auto& it : pending) {
+      if (!it.second.empty()) assign_batch(&it.second);
+    }
+  };
+
+  std::vector<std::pair<std::shared_ptr<FrameInfo>, ResultWaitingCard>> frames;
+  std::mt19937 rng(1);
+  uint64_t internal_errors = QueuingServer::InternalErrorCount();
+  auto start = std::chrono::steady_clock::now();
+  bool reconfigured = false;
+  while (flush_seq < num_batches) {
+    if (!reconfigured && flush_seq >= num_batches / 2) {
+      assign_all();  // Reconfigure 先刷出各桶中不满的批次
+      infer_pipeline->Reconfigure(infer_pipeline->GetBatchsize() - 1, max_reconfigure_pause_ms);
+      reconfigured = true;
+    }
+    auto finfo = std::make_shared<FrameInfo>();
+    finfo->item_index = static_cast<uint32_t>(frames.size());
+    finfo->shape = config.frame_shapes[rng() % config.frame_shapes.size()];
+    finfo->payload = buffer_pool->Acquire(finfo->shape.Bytes());
+    std::memset(finfo->payload->mutable_data(), finfo->item_index & 0xff, finfo->payload->size());
+    {
+      std::lock_guard<std::mutex> lk(trace_mtx);
+      batch_of[finfo.get()] = 0;  // 占位, 使阶段回调中的查找不修改容器结构
+      postproc_count.push_back(0);
+      frame_stage.push_back(0);
+    }
+    auto& bucket = pending[finfo->shape];
+    bucket.push_back(finfo.get());
+    if (bucket.size() == infer_pipeline->GetBatchsize()) assign_batch(&bucket);
+    frames.emplace_back(finfo, infer_pipeline->FeedData(finfo));
+    if (0 == rng() % 16) {
+      assign_all();
+      infer_pipeline->Flush();
+    }
+  }
+  assign_all();
+  infer_pipeline->Flush();
+
+  // 实际时间内未完成视为流水线停滞
+  std::mutex done_mtx;
+  std::condition_variable done_cond;
+  bool done = false;
+  std::thread watchdog([&]() {
+    std::unique_lock<std::mutex> lk(done_mtx);
+    if (!done_cond.wait_for(lk, std::chrono::seconds(kStallTimeoutS), [&done]() { return done; })) {
+      std::cout << "Stress: pipeline stalled for " << kStallTimeoutS << " s" << std::endl;
+      std::abort();
+    }
+  });
+  for (auto& frame : frames) frame.second.WaitForCall();
+  {
+    std::lock_guard<std::mutex> lk(done_mtx);
+    done = true;
+  }
+  done_cond.notify_all();
+  watchdog.join();
+  double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t bad_results = 0;
+  uint64_t bad_postproc = 0;
+  for (auto& frame : frames) {
+    const FrameInfo& finfo = *frame.first;
+    uint8_t expected = finfo.item_index & 0xff;
+    bool ok = !finfo.result.empty() &&
+        std::all_of(finfo.result.begin(), finfo.result.end(), [expected](uint8_t v) { return v == expected; });
+    if (!ok) bad_results++;
+    if (1 != postproc_count[finfo.item_index]) bad_postproc++;
+  }
+  internal_errors = QueuingServer::InternalErrorCount() - internal_errors;
+  uint64_t busy_resources = 0;
+  for (const auto& res : infer_pipeline->GetResources()) {
+    if (!res->Idle()) busy_resources++;
+  }
+  bool pass = 0 == order_violations && 0 == bad_results && 0 == bad_postproc && 0 == internal_errors &&
+      0 == busy_resources;
+  double virtual_s = std::chrono::duration<double>(clock->Now().time_since_epoch()).count();
+  std::cout << "Stress: " << flush_seq << " batches, " << frames.size() << " frames in " << elapsed_s
+      << " s (virtual " << virtual_s << " s), order violations " << order_violations
+      << ", bad results " << bad_results << ", postprocessing count mismatches " << bad_postproc
+      << ", internal errors " << internal_errors << ", busy resources " << busy_resources
+      << ": " << (pass ? "PASS" : "FAIL") << std::endl;
+  return pass;
+}
@@ -0,0 +1,128 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "result_sink.hpp"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                                \
+  do {                                                                             \
+    if (!(cond)) {                                                                 \
+      std::cout << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond << std::endl; \
+      failures++;                                                                  \
+    }                                                                              \
+  } while (0)
+
+std::string TempPath(const std::string& name) {
+  return "/tmp/result_sink_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+template <typename T>
+void Put(std::vector<uint8_t>* out, T value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  out->insert(out->end(), bytes, bytes + sizeof(value));
+}
+
+/**
+ * @brief 按 ResultSink 的文件格式拼出文件头与一条记录, num_children 与实际写入的子帧数可以不一致
+ */
+void WriteRawRecord(const std::string& path, uint32_t num_children, const std::vector<std::vector<uint8_t>>& children) {
+  std::vector<uint8_t> body;
+  Put<uint32_t>(&body, 7);   // batch_index
+  Put<uint32_t>(&body, 3);   // item_index
+  Put<int64_t>(&body, 100);  // pts_us
+  Put<uint32_t>(&body, 2);   // result_bytes
+  body.push_back(0xab);
+  body.push_back(0xcd);
+  Put<uint32_t>(&body, num_children);
+  for (const auto& child : children) {
+    Put<uint32_t>(&body, static_cast<uint32_t>(child.size()));
+    body.insert(body.end(), child.begin(), child.end());
+  }
+  std::vector<uint8_t> file;
+  Put<uint32_t>(&file, ResultSink::kMagic);
+  Put<uint32_t>(&file, ResultSink::kVersion);
+  Put<uint32_t>(&file, static_cast<uint32_t>(body.size()));
+  file.insert(file.end(), body.begin(), body.end());
+  std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+  ofs.write(reinterpret_cast<const char*>(file.data()), file.size());
+}
+
+void TestRoundTrip() {
+  const std::string path = TempPath("round_trip");
+  ResultSink sink(path, 4096, 2);
+  CHECK(sink.Open());
+  for (uint32_t i = 0; i < 100; ++i) {
+    FrameInfo finfo;
+    finfo.batch_index = i / 4;
+    finfo.item_index = i % 4;
+    finfo.pts_us = i * 1000;
+    finfo.result.assign(16, static_cast<uint8_t>(i));
+    for (uint32_t c = 0; c < i % 3; ++c) {
+      auto child = std::make_shared<FrameInfo>();
+      child->result.assign(8, static_cast<uint8_t>(c));
+      finfo.children.push_back(child);
+    }
+    sink.Append(finfo);
+  }
+  sink.Close();
+
+  ResultSinkReader reader(path, 64);
+  CHECK(reader.Open());
+  ResultSinkReader::Record record;
+  uint32_t records = 0;
+  while (reader.Next(&record)) {
+    CHECK(record.batch_index == records / 4);
+    CHECK(record.item_index == records % 4);
+    CHECK(record.pts_us == records * 1000);
+    CHECK(record.result == std::vector<uint8_t>(16, static_cast<uint8_t>(records)));
+    CHECK(record.children.size() == records % 3);
+    records++;
+  }
+  CHECK(records == 100);
+  CHECK(!reader.Corrupted());
+  std::remove(path.c_str());
+}
+
+void TestOversizedChildCount() {
+  const std::string path = TempPath("oversized");
+  WriteRawRecord(path, 0xffffffffu, { { 1, 2, 3 } });
+  ResultSinkReader reader(path);
+  CHECK(reader.Open());
+  ResultSinkReader::Record record;
+  CHECK(!reader.Next(&record));
+  CHECK(reader.Corrupted());
+  CHECK(record.children.empty());
+  std::remove(path.c_str());
+}
+
+void TestTruncatedChildren() {
+  const std::string path = TempPath("truncated");
+  WriteRawRecord(path, 3, { { 1, 2, 3 } });
+  ResultSinkReader reader(path);
+  CHECK(reader.Open());
+  ResultSinkReader::Record record;
+  CHECK(!reader.Next(&record));
+  CHECK(reader.Corrupted());
+  std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+  TestRoundTrip();
+  TestOversizedChildCount();
+  TestTruncatedChildren();
+  std::cout << "result_sink_test: " << (failures ? "FAIL" : "PASS") << std::endl;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pipeline_clock.hpp"
+#include "shape_bucket_batcher.hpp"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                                \
+  do {                                                                             \
+    if (!(cond)) {                                                                 \
+      std::cout << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond << std::endl; \
+      failures++;                                                                  \
+    }                                                                              \
+  } while (0)
+
+constexpr uint32_t kBatchsize = 4;
+constexpr uint32_t kMaxWaitMs = 40;
+const FrameShape kShape = { 64, 48 };
+
+/**
+ * @brief 手动时钟驱动的组批器, 只记录批次刷出的时刻, 不执行各阶段任务
+ */
+class BatcherFixture {
+ public:
+  BatcherFixture() : clock_(std::make_shared<ManualClock>(false)) {
+    auto mlu_input = std::make_shared<IOResource>(kBatchsize, kShape.Bytes());
+    mlu_input->Init();
+    batcher_ = std::make_shared<ShapeBucketBatcher>(kBatchsize, kMaxWaitMs,
+                                                    std::make_shared<IOResourceRing>(
+                                                        std::vector<std::shared_ptr<IOResource>>{ mlu_input }),
+                                                    nullptr, nullptr, nullptr);
+    batcher_->SetClock(clock_);
+    batcher_->SetVerbose(false);
+    batcher_->SetFuncs([](WorkerGroup, const std::vector<InferTaskSptr>&) {},
+                       [this](ShapeBucketBatcher::Bucket*, const BatchingDoneInput&) {
+                         std::lock_guard<std::mutex> lk(mtx_);
+                         flush_times_.push_back(clock_->Now());
+                         return ShapeBucketBatcher::StageTasks();
+                       });
+    batcher_->AddBucket(kShape);
+    batcher_->Start();
+  }
+  ~BatcherFixture() { batcher_->Stop(); }
+
+  void Feed() {
+    auto finfo = std::make_shared<FrameInfo>();
+    finfo->shape = kShape;
+    auto promise = std::make_shared<std::promise<FrameStatus>>();
+    batcher_->Feed(finfo, std::make_shared<AutoSetDone>(promise, finfo));
+  }
+
+  // 时钟停住不动, 在实际时间内等待超时线程刷出第 num 个批次
+  bool WaitForFlushes(size_t num) {
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::seconds(2)) {
+      if (Flushes().size() >= num) return true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+
+  std::vector<PipelineClock::TimePoint> Flushes() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return flush_times_;
+  }
+
+  /**
+   * @brief 逐毫秒推进 steps 毫秒, 每步后留出实际时间给超时线程, 检查期间没有批次刷出
+   */
+  void StepWithoutFlush(uint32_t steps, size_t flushed) {
+    for (uint32_t i = 0; i < steps; ++i) {
+      clock_->Advance(std::chrono::milliseconds(1));
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      CHECK(Flushes().size() == flushed);
+    }
+  }
+
+  std::shared_ptr<ManualClock> clock_;
+  std::shared_ptr<ShapeBucketBatcher> batcher_;
+
+ private:
+  std::mutex mtx_;
+  std::vector<PipelineClock::TimePoint> flush_times_;
+};
+
+void TestTimeoutFlushAtDeadline() {
+  BatcherFixture fixture;
+  fixture.clock_->Advance(std::chrono::milliseconds(7));  // 首帧不落在超时线程的起始时刻
+  auto first_arrival = fixture.clock_->Now();
+  fixture.Feed();
+  fixture.StepWithoutFlush(kMaxWaitMs - 1, 0);
+  fixture.clock_->Advance(std::chrono::milliseconds(1));
+  CHECK(fixture.WaitForFlushes(1));
+  auto flushes = fixture.Flushes();
+  CHECK(flushes.size() == 1);
+  CHECK(!flushes.empty() && flushes[0] == first_arrival + std::chrono::milliseconds(kMaxWaitMs));
+
+  auto stats = fixture.batcher_->GetStats();
+  CHECK(stats.size() == 1);
+  CHECK(!stats.empty() && stats[0].timeout_flushes == 1);
+  CHECK(!stats.empty() && stats[0].padded_slots == kBatchsize - 1);
+}
+
+void TestDeadlineFollowsFirstFrame() {
+  BatcherFixture fixture;
+  fixture.clock_->Advance(std::chrono::milliseconds(3));
+  auto first_arrival = fixture.clock_->Now();
+  fixture.Feed();
+  fixture.StepWithoutFlush(10, 0);
+  fixture.Feed();  // 后到的帧不推迟桶的截止时刻
+  fixture.StepWithoutFlush(kMaxWaitMs - 11, 0);
+  fixture.clock_->Advance(std::chrono::milliseconds(1));
+  CHECK(fixture.WaitForFlushes(1));
+  auto flushes = fixture.Flushes();
+  CHECK(!flushes.empty() && flushes[0] == first_arrival + std::chrono::milliseconds(kMaxWaitMs));
+}
+
+void TestFullBatchSkipsTimeout() {
+  BatcherFixture fixture;
+  for (uint32_t i = 0; i < kBatchsize; ++i) fixture.Feed();
+  CHECK(fixture.Flushes().size() == 1);  // 满批在 Feed 中同步刷出
+
+  // 满批刷出后桶为空, 下一帧重新计时
+  fixture.StepWithoutFlush(5, 1);
+  auto next_arrival = fixture.clock_->Now();
+  fixture.Feed();
+  fixture.StepWithoutFlush(kMaxWaitMs - 1, 1);
+  fixture.clock_->Advance(std::chrono::milliseconds(1));
+  CHECK(fixture.WaitForFlushes(2));
+  auto flushes = fixture.Flushes();
+  CHECK(flushes.size() == 2 && flushes[1] == next_arrival + std::chrono::milliseconds(kMaxWaitMs));
+
+  auto stats = fixture.batcher_->GetStats();
+  CHECK(!stats.empty() && stats[0].batches == 2);
+  CHECK(!stats.empty() && stats[0].timeout_flushes == 1);
+}
+
+}  // namespace
+
+int main() {
+  TestTimeoutFlushAtDeadline();
+  TestDeadlineFollowsFirstFrame();
+  TestFullBatchSkipsTimeout();
+  std::cout << "shape_bucket_batcher_test: " << (failures ? "FAIL" : "PASS") << std::endl;
+  return failures ? 1 : 0;
+}